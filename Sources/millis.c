@@ -7,23 +7,34 @@
  * @github   https://github.com/aKaReZa75
  * 
  * @note     This library provides Arduino-style millis() functionality for
- *           AVR microcontrollers using Timer0 in CTC mode with interrupt.
+ *           AVR microcontrollers using a tick timer (MILLIS_TIMER, Timer0 by
+ *           default) in CTC mode with interrupt.
  * 
  * @note     FUNCTION SUMMARY:
- *           - millis_Init          : Initialize Timer0 for 1ms interrupt generation
- *           - TIMER0_COMPA_vect ISR: Interrupt service routine that increments millisecond counter
+ *           - millis_Init          : Initialize the tick timer for MILLIS_TICK_HZ interrupt generation
+ *           - MILLIS_COMPA_vect ISR: Interrupt service routine that increments millisecond counter
+ *           - micros               : Microsecond timestamp from System_millis and the timer count
+ *           - millis_Stamp         : Raw (System_millis, count) capture, converted by millis_Stamp_Us
+ *           - millis_Scheduler     : Cooperative scheduler over a millis_Task_T table
+ *           - millis_Idle          : Sleep until timeout or interrupt, optionally tickless
+ *           - millis_Delay         : Blocking delay that sleeps between wake-ups
+ *           - millis_WaitUntil     : Sleep until a condition is true or a timeout elapses
  * 
  * @note     Requirements:
  *           - Global interrupts must be enabled via globalInt_Enable() or sei()
- *           - Timer0 must not be used for other purposes (PWM, etc.)
- *           - CPU frequency assumed to be 16MHz (adjust OCR0A for different frequencies)
+ *           - The tick timer (MILLIS_TIMER, Timer0 by default) must not be
+ *             used for other purposes (PWM, etc.)
+ *           - With MILLIS_RTC Timer2 is used instead and needs a 32.768kHz
+ *             crystal on TOSC1/TOSC2 (these pins are lost as GPIO)
+ *           - On AVR-0/1 devices the tick uses TCBn (MILLIS_TCB, TCB0 by
+ *             default), or the RTC with MILLIS_RTC. TCA stays free
+ *           - F_CPU must be defined, prescaler and MILLIS_OCR are derived from it
+ *             at compile time (see TIMER CONFIGURATION in millis.h)
  * 
  * @note     Usage Example:
- *           extern volatile uint32_t System_millis;
  *           millis_Init();              // Initialize timer
  *           globalInt_Enable();         // Enable global interrupts
- *           uint32_t start = System_millis;
- *           while ((System_millis - start) < 1000); // Wait 1 second
+ *           millis_Delay(1000);         // Wait 1 second, asleep between ticks
  * 
  * @note     For detailed documentation with examples, visit:
  *           https://github.com/aKaReZa75/AVR_millis
@@ -31,13 +42,528 @@
  */
 
 #include "millis.h"
+#if !MILLIS_HOST
+#include <avr/sleep.h>
+#endif
+#include <stddef.h>
+#if MILLIS_WATCHDOG
+#include <avr/wdt.h>
+#endif
 
 
 /* ============================================================================
  *                         GLOBAL VARIABLES
  * ============================================================================ */
-volatile uint32_t System_millis = 0;     /**< System millisecond counter - incremented every 1ms by ISR */
+volatile uint32_t System_millis = 0;     /**< System millisecond counter - advanced every tick by ISR */
                                          /**< volatile keyword ensures compiler doesn't optimize access */
+#if MILLIS_UPTIME
+volatile uint16_t System_millisEpoch = 0;    /**< Rollovers of System_millis, bumped by the tick ISR on wrap */
+#endif
+
+#if MILLIS_DIVIDERS
+volatile uint8_t  System_tick10ms  = 0;  /**< 10ms periods, advanced by millis_Divide */
+volatile uint8_t  System_tick100ms = 0;  /**< 100ms periods */
+volatile uint16_t System_seconds   = 0;  /**< Seconds */
+volatile uint8_t  System_tickFlags = 0;  /**< MILLIS_FLAG_xxx, cleared by millis_TickFlag */
+static uint8_t millis_Div10  = 0;        /**< Milliseconds into the current 10ms, 0..9 */
+static uint8_t millis_Div100 = 0;        /**< 10ms periods into the current 100ms, 0..9 */
+static uint8_t millis_Div1s  = 0;        /**< 100ms periods into the current second, 0..9 */
+#endif
+
+#if MILLIS_FRACT_ACTIVE || MILLIS_PWM_FRACT
+static millis_Fract_T millis_FractAcc = 0;   /**< Bresenham accumulator, fraction carried between ticks */
+#endif
+
+#if MILLIS_RUNTIME_PERIOD
+static millis_Count_T millis_PeriodCompare = (millis_Count_T)((MILLIS_CAL_NOMINAL >> 16) - 1);  /**< Compare value of the short period */
+static uint16_t millis_PeriodRem = (uint16_t)MILLIS_CAL_NOMINAL;  /**< Fraction of a count per tick, 1/65536 units */
+static uint16_t millis_PeriodAcc = 0;    /**< Fraction accumulator, carry = long period */
+static uint32_t millis_UsScale   = MILLIS_US_SCALE;  /**< Microseconds per count, MILLIS_US_SHIFT fraction bits, follows the period */
+#endif
+
+#if MILLIS_CALIBRATE
+static volatile uint32_t millis_CalStamp;            /**< micros() at the last stamped reference edge */
+static volatile uint8_t  millis_CalEdges = 0;        /**< Edges stamped since the last millis_Calibrate_Edge, saturates at 255 */
+static uint32_t millis_CalEdge;          /**< Stamp of the edge the last interval ended on */
+static bool     millis_CalEdgeValid = false;         /**< millis_CalEdge holds a timestamp */
+#endif
+
+#if MILLIS_TICK_RATE
+/* -------------------------------------------------------
+ * @brief Timer setting of one tick rate, prepared by millis_SetTickRate
+ * ------------------------------------------------------- */
+typedef struct
+{
+    uint32_t       Scale;        /**< Microseconds per count in 24.8 */
+    uint16_t       Hz;           /**< Tick rate */
+    uint16_t       Ms;           /**< Whole milliseconds per tick */
+    uint16_t       UsRem;        /**< Microseconds per tick above Ms */
+    uint16_t       Rem;          /**< Fraction of a count per tick, 1/65536 units */
+    millis_Count_T Compare;      /**< Compare value of the short period */
+    uint8_t        Cs;           /**< Clock select bits of the prescaler */
+    uint8_t        Shift;        /**< log2 of the prescaler */
+} millis_Rate_T;
+
+#define MILLIS_PRESCALER_SHIFT  (((MILLIS_PRESCALER) == 1)   ? 0 : ((MILLIS_PRESCALER) == 8)   ? 3 : \
+                                 ((MILLIS_PRESCALER) == 32)  ? 5 : ((MILLIS_PRESCALER) == 64)  ? 6 : \
+                                 ((MILLIS_PRESCALER) == 128) ? 7 : ((MILLIS_PRESCALER) == 256) ? 8 : 10)
+
+static uint16_t millis_TickHz    = MILLIS_TICK_HZ;      /**< Tick rate in effect */
+static uint16_t millis_TickMs    = MILLIS_MS_PER_TICK;  /**< Whole milliseconds added per tick */
+static uint16_t millis_TickUsRem = 0;    /**< Microseconds per tick above millis_TickMs */
+static uint16_t millis_TickAcc   = 0;    /**< Microseconds not yet carried into System_millis, below 1000 */
+static uint16_t millis_PeriodOwe = 0;    /**< Counts still to add to short periods, see millis_Rate_Apply */
+static uint8_t  millis_RateShift = MILLIS_PRESCALER_SHIFT;  /**< log2 of the prescaler in effect */
+static millis_Rate_T millis_RateNext;    /**< Rate to switch to on the next tick */
+static volatile bool millis_RatePending = false;    /**< millis_RateNext waits for the tick ISR */
+#endif
+
+#if MILLIS_ISR_TASKS
+/* -------------------------------------------------------
+ * @brief Callback slot of the tick ISR
+ * @note Only the ISR and critical sections touch a slot, no volatile
+ * ------------------------------------------------------- */
+typedef struct
+{
+    void    (*Callback)(void);   /**< Function to call, NULL = slot free */
+    uint16_t  Period;            /**< Period in ticks */
+    uint16_t  Countdown;         /**< Ticks until the next call */
+} millis_IsrTask_T;
+
+static millis_IsrTask_T millis_IsrTasks[MILLIS_ISR_TASKS];   /**< ISR callback table */
+#endif
+
+#if MILLIS_WATCHDOG
+/* -------------------------------------------------------
+ * @brief Deadline of a monitored task
+ * @note Changed in critical sections only, no volatile
+ * ------------------------------------------------------- */
+typedef struct
+{
+    uint16_t  Budget;            /**< Ticks per deadline, 0 = not monitored */
+    uint16_t  Countdown;         /**< Ticks until the deadline, 0 = not monitored */
+} millis_Wdg_T;
+
+static millis_Wdg_T millis_Wdg[MILLIS_WATCHDOG];     /**< Deadline table */
+millis_WdgReport_T millis_WdgLast __attribute__((section(".noinit")));       /**< Survives the deadline reset, not static: WDT_vect stores to it by name */
+static uint8_t millis_ResetFlags __attribute__((section(".noinit")));  /**< MCUSR as found by millis_Watchdog_Boot, .bss is cleared after .init3 */
+#endif
+
+#if MILLIS_ISR_STATS
+static millis_IsrStats_T millis_IsrStats;    /**< Tick ISR statistics, updated by the tick ISR only */
+#endif
+
+#if MILLIS_MISSED
+static volatile uint16_t millis_MissedCount = 0; /**< Ticks served late, saturates at UINT16_MAX */
+#endif
+
+#if MILLIS_EVENTS
+static void (* volatile millis_Events[MILLIS_EVENTS])(void);  /**< Ring of handlers posted by ISRs */
+static volatile uint8_t millis_EventHead = 0;    /**< Free-running write index, producer (ISR) only */
+static volatile uint8_t millis_EventTail = 0;    /**< Free-running read index, consumer (main loop) only */
+#endif
+
+#if MILLIS_TICKLESS
+static volatile uint8_t millis_Span = 1; /**< Ticks covered by the running timer period (1 = normal tick) */
+static millis_Count_T millis_WindowTop;  /**< Compare value of the first period of the running sleep window */
+static millis_Count_T millis_PeriodBase = 0; /**< Count where the running tick started (non-zero after an early wake) */
+    #if MILLIS_FRACT_ACTIVE
+static millis_Fract_T millis_WindowAcc;  /**< Accumulator value at the start of the sleep window */
+    #endif
+#endif
+
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+#if MILLIS_DIVIDERS
+/* -------------------------------------------------------
+ * @brief Advance the cascaded 10ms / 100ms / 1s dividers
+ * @param _Step Milliseconds to add
+ * @retval None
+ * @note A 1ms tick that does not end a 10ms period costs an 8-bit subtract,
+ *       compare and add. The cascade below only runs every 10ms, and each
+ *       stage is an 8-bit count to 10
+ * @note A step of many periods (sleep window, millis_Catchup) runs the
+ *       loop once per 10ms, so every counter stays in step with
+ *       System_millis
+ * ------------------------------------------------------- */
+static inline void millis_Divide(millis_Step_T _Step)
+{
+    uint8_t       _Left  = 10 - millis_Div10;   /**< Milliseconds to the next 10ms boundary, 1..10 */
+    uint8_t       _Flags = MILLIS_FLAG_10MS;
+    millis_Step_T _Ms;
+
+    if (_Step < _Left)
+    {
+        millis_Div10 += (uint8_t)_Step;
+        return;
+    }
+
+    _Ms = _Step - _Left;                 /**< Past the first boundary, can not overflow like Div10 + _Step */
+    for (;;)
+    {
+        System_tick10ms++;
+        if (++millis_Div100 == 10)
+        {
+            millis_Div100 = 0;
+            System_tick100ms++;
+            _Flags |= MILLIS_FLAG_100MS;
+            if (++millis_Div1s == 10)
+            {
+                millis_Div1s = 0;
+                System_seconds++;
+                _Flags |= MILLIS_FLAG_1S;
+            }
+        }
+        if (_Ms < 10)
+        {
+            break;
+        }
+        _Ms -= 10;
+    }
+
+    millis_Div10 = (uint8_t)_Ms;
+    System_tickFlags |= _Flags;
+};
+#endif
+
+/* -------------------------------------------------------
+ * @brief Advance System_millis by a number of milliseconds
+ * @param _Step Milliseconds to add
+ * @retval None
+ * @note Called with interrupts disabled (ISR or critical section)
+ * @note With MILLIS_UPTIME a sum below _Step means the 32-bit counter
+ *       has wrapped, only then the epoch is touched. The common path
+ *       costs one extra compare
+ * @note millis_Step_T is 32 bits only when a sleep window can cover
+ *       more than 65535ms (MILLIS_TICKLESS_MAX * MILLIS_MS_PER_TICK)
+ * @note With MILLIS_DIVIDERS the coarse counters follow every step, so
+ *       sleep windows, rate switches and millis_Catchup keep them right
+ * ------------------------------------------------------- */
+static inline void millis_Advance(millis_Step_T _Step)
+{
+#if MILLIS_DIVIDERS
+    millis_Divide(_Step);
+#endif
+#if MILLIS_UPTIME
+    uint32_t _Now = System_millis + _Step;
+
+    System_millis = _Now;
+    if (_Now < _Step)
+    {
+        System_millisEpoch++;            /**< 32-bit rollover, carry into the epoch */
+    }
+#else
+    System_millis += _Step;
+#endif
+};
+
+#if MILLIS_FRACT_ACTIVE || MILLIS_PWM_FRACT
+/* -------------------------------------------------------
+ * @brief Advance a Bresenham accumulator by one tick
+ * @param _Acc Accumulator to advance
+ * @retval 1 if the tick is a long period (one extra count), else 0
+ * @note With MILLIS_PWM the carry is one extra millisecond instead
+ * ------------------------------------------------------- */
+static inline uint8_t millis_Fract_Step(millis_Fract_T *_Acc)
+{
+    *_Acc += MILLIS_FRACT_REM;           /**< Carry the fractional count into this period */
+    if (*_Acc >= MILLIS_FRACT_DEN)
+    {
+        *_Acc -= MILLIS_FRACT_DEN;
+        return 1;                        /**< Long period, absorbs one whole count */
+    }
+    return 0;                            /**< Short period */
+};
+#endif
+
+
+#if MILLIS_RUNTIME_PERIOD
+/* -------------------------------------------------------
+ * @brief Set the compare value of the period that has just started
+ * @retval None
+ * @note The fraction is summed in 16 bits, its carry selects the long
+ *       period (one count more), so the average is Compare + 1 +
+ *       Rem / 65536 counts
+ * @note With MILLIS_TICK_RATE a short period can also be made long to
+ *       pay back millis_PeriodOwe. One count more per period keeps
+ *       micros() monotonic, the count before the wrap still reads at
+ *       most one nominal period
+ * ------------------------------------------------------- */
+static inline void millis_Period_Next(void)
+{
+    uint16_t _Acc  = millis_PeriodAcc + millis_PeriodRem;
+    uint8_t  _Long = (_Acc < millis_PeriodAcc);     /**< Wrap of the 16-bit fraction = long period */
+
+#if MILLIS_TICK_RATE
+    if (!_Long && millis_PeriodOwe)
+    {
+        _Long = 1;
+        millis_PeriodOwe--;
+    }
+#endif
+    MILLIS_OCR = millis_PeriodCompare + _Long;
+    millis_PeriodAcc = _Acc;
+};
+#endif
+
+
+#if MILLIS_TICK_RATE
+/* -------------------------------------------------------
+ * @brief Switch to millis_RateNext right after a compare match
+ * @retval None
+ * @note Called from the tick ISR. The counts since the match are added
+ *       to the microsecond accumulator at the old scale, then the
+ *       counter and the prescaler restart together, so the new period
+ *       starts exactly here and no time is counted twice or lost (the
+ *       few cycles between reading and clearing the counter aside)
+ * @note Every tick adds the nominal period, while the counter runs the
+ *       short and long periods. The time counted ahead of the counter
+ *       is the owed counts plus the fraction summed so far plus the one
+ *       of the period that just ended. It is carried into the new rate
+ *       as a start fraction and owed counts, otherwise each switch away
+ *       from a fractional period would leave micros() up to one count
+ *       ahead for good
+ * ------------------------------------------------------- */
+static void millis_Rate_Apply(void)
+{
+    millis_Count_T _Elapsed = MILLIS_TCNT;   /**< Counts since the match, old prescaler */
+    uint32_t _Ahead = ((uint32_t)millis_PeriodOwe << 16) + millis_PeriodAcc + millis_PeriodRem;  /**< Old counts in 16.16 */
+    uint32_t _Us;
+
+    MILLIS_TCCRB = (MILLIS_TCCRB & ~MILLIS_CS_MASK) | millis_RateNext.Cs;
+    MILLIS_TCNT  = 0;
+#if (MILLIS_TIMER == 2) && defined(PSRASY)
+    bitSet(GTCCR, PSRASY);               /**< First count one full prescaler period after the restart */
+#elif (MILLIS_TIMER != 2) && defined(PSRSYNC)
+    bitSet(GTCCR, PSRSYNC);              /**< Same, note the prescaler is shared with the other synchronous timers */
+#endif
+    MILLIS_OCR   = millis_RateNext.Compare;
+
+    _Us = millis_TickAcc + (((uint32_t)_Elapsed * millis_UsScale) >> 8);
+    millis_Advance((uint16_t)(_Us / 1000));
+    millis_TickAcc = (uint16_t)(_Us % 1000);
+
+    if (millis_RateNext.Shift > millis_RateShift)
+    {
+        _Ahead >>= (millis_RateNext.Shift - millis_RateShift);
+    }
+    else
+    {
+        _Ahead <<= (millis_RateShift - millis_RateNext.Shift);
+    }
+
+    millis_PeriodCompare = millis_RateNext.Compare;
+    millis_PeriodRem     = millis_RateNext.Rem;
+    millis_PeriodAcc     = (uint16_t)_Ahead;
+    millis_PeriodOwe     = (uint16_t)(_Ahead >> 16);
+    millis_RateShift     = millis_RateNext.Shift;
+    millis_UsScale       = millis_RateNext.Scale;
+    millis_TickHz        = millis_RateNext.Hz;
+    millis_TickMs        = millis_RateNext.Ms;
+    millis_TickUsRem     = millis_RateNext.UsRem;
+    millis_RatePending   = false;
+};
+#endif
+
+
+#if MILLIS_ISR_TASKS
+/* -------------------------------------------------------
+ * @brief Count down the ISR callback slots and run the due ones
+ * @param _Ticks Ticks that have passed since the last call
+ * @retval None
+ * @note Called with interrupts disabled. Tickless sleep windows end on
+ *       the earliest due tick, so an early wake never makes a slot due
+ * ------------------------------------------------------- */
+static inline void millis_IsrTask_Run(uint8_t _Ticks)
+{
+    for (uint8_t _Slot = 0; _Slot < MILLIS_ISR_TASKS; _Slot++)
+    {
+        millis_IsrTask_T *_Task = &millis_IsrTasks[_Slot];
+
+        if (_Task->Callback == NULL)
+        {
+            continue;
+        }
+        if (_Task->Countdown > _Ticks)
+        {
+            _Task->Countdown -= _Ticks;
+        }
+        else
+        {
+            _Task->Countdown = _Task->Period;    /**< Re-arm first, the callback may stop its slot */
+            _Task->Callback();
+        }
+    }
+};
+#endif
+
+
+#if MILLIS_WATCHDOG
+/* -------------------------------------------------------
+ * @brief Record a missed deadline and start the controlled reset
+ * @param _Id Task that missed its deadline
+ * @retval None
+ * @note Runs in the tick ISR. All deadlines are stopped, so the record
+ *       of the first task to expire is kept. The watchdog is armed for
+ *       16ms in interrupt and reset mode (timed sequence, four cycles)
+ * ------------------------------------------------------- */
+static void millis_Watchdog_Expire(uint8_t _Id)
+{
+    millis_WdgLast.Task   = _Id;
+    millis_WdgLast.Pc     = 0;           /**< Filled in by WDT_vect */
+    millis_WdgLast.Millis = System_millis;
+    millis_WdgLast.Magic  = MILLIS_WDG_MAGIC;
+
+    for (uint8_t _Task = 0; _Task < MILLIS_WATCHDOG; _Task++)
+    {
+        millis_Wdg[_Task].Budget    = 0;
+        millis_Wdg[_Task].Countdown = 0;
+    }
+
+    wdt_reset();
+#if defined(WDTCSR) && defined(WDIE)
+    WDTCSR = (1 << WDCE) | (1 << WDE);
+    WDTCSR = (1 << WDIE) | (1 << WDE);   /**< 16ms, interrupt first, reset on the next time-out */
+#else
+    wdt_enable(WDTO_15MS);               /**< No interrupt stage on this device, Pc stays unknown */
+#endif
+};
+
+/* -------------------------------------------------------
+ * @brief Count down the task deadlines
+ * @param _Ticks Ticks that have passed since the last call
+ * @retval None
+ * @note Called with interrupts disabled. Tickless sleep windows end on
+ *       the earliest deadline, so an early wake never reaches one
+ * ------------------------------------------------------- */
+static inline void millis_Watchdog_Run(uint8_t _Ticks)
+{
+    for (uint8_t _Id = 0; _Id < MILLIS_WATCHDOG; _Id++)
+    {
+        uint16_t _Count = millis_Wdg[_Id].Countdown;
+
+        if (_Count == 0)
+        {
+            continue;
+        }
+        if (_Count > _Ticks)
+        {
+            millis_Wdg[_Id].Countdown = _Count - _Ticks;
+        }
+        else
+        {
+            millis_Watchdog_Expire(_Id);
+            return;
+        }
+    }
+};
+#endif
+
+
+#if MILLIS_ISR_STATS
+/* -------------------------------------------------------
+ * @brief Account the tick ISR that is about to return
+ * @param _Entry   Timer count read at the start of the ISR body
+ * @param _Periods Tick periods this interrupt covers
+ * @retval None
+ * @note The counter restarts at 0 on the compare match (overflow with
+ *       MILLIS_PWM), so the count at entry is the entry latency
+ * ------------------------------------------------------- */
+static inline void millis_IsrStats_Account(millis_Count_T _Entry, uint8_t _Periods)
+{
+    millis_Count_T _Exit = MILLIS_TCNT;
+    uint16_t _Busy;
+
+    if (_Exit >= _Entry)
+    {
+        _Busy = _Exit - _Entry;
+    }
+    else
+    {
+        _Busy = (uint16_t)(_Exit + MILLIS_PERIOD_COUNTS - _Entry);   /**< Body ran over the next compare match */
+    }
+    millis_IsrStats.Busy    += _Busy;
+    millis_IsrStats.Periods += _Periods;
+    if (millis_IsrStats.Calls < UINT16_MAX)
+    {
+        millis_IsrStats.Calls++;
+    }
+    if (_Busy > millis_IsrStats.MaxBusy)
+    {
+        millis_IsrStats.MaxBusy = _Busy;
+    }
+    if (_Entry > millis_IsrStats.MaxLatency)
+    {
+        millis_IsrStats.MaxLatency = _Entry;
+    }
+};
+#endif
+
+
+#if MILLIS_MISSED
+/* -------------------------------------------------------
+ * @brief Count the running tick if it was served late
+ * @param _Entry Timer count read at the start of the ISR body
+ * @retval None
+ * @note A tick flag that is set again before the ISR returns means the
+ *       next period has already ended: the tick ran a whole period late
+ *       and one more such delay loses a tick. An entry count at or above
+ *       MILLIS_MISSED_LATENCY means the ISR was held off for that long
+ *       (plus an unknown number of whole periods)
+ * ------------------------------------------------------- */
+static inline void millis_Missed_Check(millis_Count_T _Entry)
+{
+#if MILLIS_PWM
+    if ((_Entry >= MILLIS_MISSED_LATENCY) || bit_is_set(MILLIS_TIFR, MILLIS_TOV))
+#else
+    if ((_Entry >= MILLIS_MISSED_LATENCY) || bit_is_set(MILLIS_TIFR, MILLIS_OCF))
+#endif
+    {
+        if (millis_MissedCount < UINT16_MAX)
+        {
+            millis_MissedCount++;
+        }
+    }
+};
+#endif
+
+
+#if MILLIS_RTC && MILLIS_AVR01
+/* -------------------------------------------------------
+ * @brief Wait until all RTC register writes are synchronised
+ * @retval None
+ * @note CTRLA, CNT, PER and CMP live in the RTC clock domain. A write
+ *       while the busy flag of that register is set in RTC.STATUS is
+ *       ignored, so each of them is written again only after this wait
+ * ------------------------------------------------------- */
+static void millis_Async_Wait(void)
+{
+    while (RTC.STATUS)
+    {
+        ;                                /**< Busy flags clear on the RTC clock */
+    }
+};
+#elif MILLIS_RTC
+/* -------------------------------------------------------
+ * @brief Wait until all Timer2 register writes are synchronised
+ * @retval None
+ * @note In asynchronous mode TCNT2, OCR2x and TCCR2x are copied to the
+ *       crystal clock domain on TOSC1 edges, which takes up to two
+ *       crystal cycles (61us). A register written again before its
+ *       update busy flag clears may be corrupted, and power-save must
+ *       not be entered while a transfer is pending
+ * ------------------------------------------------------- */
+static void millis_Async_Wait(void)
+{
+    while (ASSR & ((1 << TCN2UB) | (1 << OCR2AUB) | (1 << OCR2BUB) | (1 << TCR2AUB) | (1 << TCR2BUB)))
+    {
+        ;                                /**< Update busy flags clear on the crystal clock */
+    }
+};
+#endif
 
 
 /* ============================================================================
@@ -45,18 +571,176 @@ volatile uint32_t System_millis = 0;     /**< System millisecond counter - incre
  * ============================================================================ */
 
 /* -------------------------------------------------------
- * @brief Timer0 Compare Match A Interrupt Service Routine
+ * @brief Tick timer Compare Match A Interrupt Service Routine
  * @retval None
- * @note This ISR is called every 1 millisecond when Timer0 matches OCR0A
- *       Increments the global millisecond counter
+ * @note This ISR is called every tick (1 / MILLIS_TICK_HZ) when the tick
+ *       timer matches MILLIS_OCR. Advances the global millisecond counter by
+ *       MILLIS_MS_PER_TICK
+ * @note The vector and registers follow MILLIS_TIMER, e.g. Timer1 uses
+ *       TIMER1_COMPA_vect and OCR1A
+ * @note With MILLIS_FRACT_ACTIVE the period that has just started is set
+ *       to MILLIS_COMPARE or MILLIS_COMPARE + 1 counts, Bresenham style.
+ *       The long period is taken MILLIS_FRACT_REM times in every
+ *       MILLIS_FRACT_DEN ticks, so the average period is exact and the
+ *       long-term accuracy equals the crystal. MILLIS_OCR is written right
+ *       after the compare, while MILLIS_TCNT is still far below it.
  * @note IMPORTANT: Global interrupts must be enabled for this ISR to execute
  *       Call globalInt_Enable macro or manually set I-bit in SREG
  * @note ISR execution time should be minimal to avoid timing drift
  * ------------------------------------------------------- */
-ISR(TIMER0_COMPA_vect)
+#if MILLIS_ISR_NAKED
+/* -------------------------------------------------------
+ * @brief Hand-tuned tick timer Compare Match A ISR (MILLIS_ISR_NAKED = 1)
+ * @retval None
+ * @note Saves only r24 and SREG. The 32-bit counter is advanced one byte
+ *       at a time: SUBI adds the step to the low byte, then each SBCI
+ *       with 0xFF adds the carry to the next byte (borrow set = no carry)
+ * @note Cycle budget per tick (2-byte PC devices, e.g. ATmega328P):
+ *       - Interrupt response + vector JMP  :  7 cycles
+ *       - Body (push/in/push, 4 x lds/op/sts, pop/out/pop) : 30 cycles
+ *       - RETI                             :  4 cycles
+ *       - Total                            : 41 cycles (~2.6us at 16MHz)
+ *       The compiler generated ISR takes about 62 cycles
+ * @note With MILLIS_UPTIME a set carry after the last byte (SBCI leaves
+ *       C clear) bumps System_millisEpoch. The BRCS skipping it adds 2
+ *       cycles per tick (43 total), the rollover tick takes 8 more
+ * ------------------------------------------------------- */
+ISR(MILLIS_COMPA_vect, ISR_NAKED)
 {
-    System_millis++;                     /**< Increment millisecond counter - atomic operation on AVR */
+    __asm__ __volatile__
+    (
+        "push r24                           \n\t"
+        "in   r24, __SREG__                 \n\t"
+        "push r24                           \n\t"
+        "lds  r24, %[cnt]+0                 \n\t"
+        "subi r24, lo8(-(%[step]))          \n\t"   /* Byte 0 += step, C = no carry */
+        "sts  %[cnt]+0, r24                 \n\t"
+        "lds  r24, %[cnt]+1                 \n\t"
+        "sbci r24, 0xFF                     \n\t"   /* Byte 1 += carry */
+        "sts  %[cnt]+1, r24                 \n\t"
+        "lds  r24, %[cnt]+2                 \n\t"
+        "sbci r24, 0xFF                     \n\t"   /* Byte 2 += carry */
+        "sts  %[cnt]+2, r24                 \n\t"
+        "lds  r24, %[cnt]+3                 \n\t"
+        "sbci r24, 0xFF                     \n\t"   /* Byte 3 += carry */
+        "sts  %[cnt]+3, r24                 \n\t"
+#if MILLIS_UPTIME
+        "brcs 1f                            \n\t"   /* C set = no 32-bit rollover */
+        "lds  r24, %[ep]+0                  \n\t"
+        "subi r24, 0xFF                     \n\t"   /* Epoch byte 0 += 1 */
+        "sts  %[ep]+0, r24                  \n\t"
+        "lds  r24, %[ep]+1                  \n\t"
+        "sbci r24, 0xFF                     \n\t"   /* Epoch byte 1 += carry */
+        "sts  %[ep]+1, r24                  \n\t"
+        "1:                                 \n\t"
+#endif
+        "pop  r24                           \n\t"
+        "out  __SREG__, r24                 \n\t"
+        "pop  r24                           \n\t"
+        "reti                               \n\t"
+        :
+        : [cnt]  "i" (&System_millis),
+#if MILLIS_UPTIME
+          [ep]   "i" (&System_millisEpoch),
+#endif
+          [step] "i" (MILLIS_MS_PER_TICK)
+    );
+};
+#elif MILLIS_PWM
+/* -------------------------------------------------------
+ * @brief Timer Overflow ISR (MILLIS_PWM = 1)
+ * @retval None
+ * @note The timer runs free in Fast PWM mode, so OCnA/OCnB keep driving
+ *       their outputs. Each overflow adds MILLIS_PWM_MS and the carry of
+ *       the sub-millisecond fraction, like the Arduino core does with
+ *       FRACT_INC/FRACT_MAX, but derived from F_CPU at compile time
+ * ------------------------------------------------------- */
+ISR(MILLIS_OVF_vect)
+{
+#if MILLIS_ISR_STATS || MILLIS_MISSED
+    millis_Count_T _Entry = MILLIS_TCNT; /**< Counts since the overflow = entry latency */
+#endif
+
+#if MILLIS_PWM_FRACT
+    millis_Advance(MILLIS_PWM_MS + millis_Fract_Step(&millis_FractAcc));    /**< Whole ms plus fraction carry */
+#else
+    millis_Advance(MILLIS_PWM_MS);       /**< Overflow is a whole number of milliseconds */
+#endif
+
+#if MILLIS_ISR_STATS
+    millis_IsrStats_Account(_Entry, 1);
+#endif
+#if MILLIS_MISSED
+    millis_Missed_Check(_Entry);
+#endif
+};
+#else
+ISR(MILLIS_COMPA_vect)
+{
+#if MILLIS_ISR_STATS || MILLIS_MISSED
+    millis_Count_T _Entry = MILLIS_TCNT; /**< Counts since the compare match = entry latency */
+#endif
+#if MILLIS_TICKLESS
+    uint8_t _Span = millis_Span;
+
+    millis_Advance((millis_Step_T)_Span * MILLIS_MS_PER_TICK);        /**< A sleep window covers millis_Span ticks */
+    millis_Span       = 1;
+    millis_PeriodBase = 0;
+#elif MILLIS_TICK_RATE
+    uint16_t _Us = millis_TickAcc + millis_TickUsRem;
+    uint16_t _Ms = millis_TickMs;
+
+    if (_Us >= 1000)
+    {
+        _Us -= 1000;                     /**< Sub-millisecond ticks carry into System_millis */
+        _Ms++;
+    }
+    millis_TickAcc = _Us;
+    millis_Advance(_Ms);
+#else
+    millis_Advance(MILLIS_MS_PER_TICK);  /**< Advance millisecond counter - NOT atomic for readers, see millis() */
+#endif
+    MILLIS_ISR_ACK();                    /**< AVR-0/1 keep the flag set, clear it before any callback reads micros() */
+
+#if MILLIS_TICK_RATE
+    if (millis_RatePending)
+    {
+        millis_Rate_Apply();             /**< Counter is just past the match, the best point to switch */
+    }
+    else
+    {
+        millis_Period_Next();
+    }
+#elif MILLIS_RUNTIME_PERIOD
+    millis_Period_Next();
+#elif MILLIS_FRACT_ACTIVE
+    MILLIS_OCR = MILLIS_COMPARE + millis_Fract_Step(&millis_FractAcc);   /**< Short or long period */
+#elif MILLIS_TICKLESS
+    MILLIS_OCR = MILLIS_COMPARE;         /**< Back to a single tick after a sleep window */
+#endif
+
+#if MILLIS_WATCHDOG && MILLIS_TICKLESS
+    millis_Watchdog_Run(_Span);
+#elif MILLIS_WATCHDOG
+    millis_Watchdog_Run(1);
+#endif
+
+#if MILLIS_ISR_TASKS && MILLIS_TICKLESS
+    millis_IsrTask_Run(_Span);           /**< Compare value is set, callbacks can take their time */
+#elif MILLIS_ISR_TASKS
+    millis_IsrTask_Run(1);               /**< Compare value is set, callbacks can take their time */
+#endif
+
+#if MILLIS_ISR_STATS && MILLIS_TICKLESS
+    millis_IsrStats_Account(_Entry, _Span);
+#elif MILLIS_ISR_STATS
+    millis_IsrStats_Account(_Entry, 1);
+#endif
+#if MILLIS_MISSED
+    millis_Missed_Check(_Entry);
+#endif
 };
+#endif /* MILLIS_ISR_NAKED */
 
 
 /* ============================================================================
@@ -64,42 +748,1302 @@ ISR(TIMER0_COMPA_vect)
  * ============================================================================ */
 
 /* -------------------------------------------------------
- * @brief Initialize Timer0 for millisecond timing
+ * @brief Initialize the tick timer for millisecond timing
  * @retval None
+ * @note With MILLIS_RTC Timer2 is switched to the TOSC1/TOSC2 crystal
+ *       first, following the asynchronous start-up sequence of the
+ *       datasheet. The crystal needs up to one second to settle after
+ *       power-up, millis runs slow or stalls until then
+ * @note On AVR-0/1 devices TCBn runs in periodic interrupt mode with
+ *       CCMP as the period, or with MILLIS_RTC the RTC counter runs
+ *       with PER as the period and keeps running in standby
  * @note Configuration details:
  *       - Mode: CTC (Clear Timer on Compare Match) - Mode 2
- *       - Prescaler: 64 (CS02:CS00 = 011)
- *       - Compare value: 249 (for 1ms at 16MHz)
+ *       - Prescaler: MILLIS_PRESCALER (CS02:CS00 = MILLIS_CLOCK_SELECT)
+ *       - Compare value: MILLIS_COMPARE
  *       - Interrupt: Compare Match A enabled
- * @note Timer calculation for 16MHz clock:
+ * @note All values are compile-time constants, e.g. for 16MHz and 1kHz:
  *       Timer_freq = F_CPU / Prescaler = 16MHz / 64 = 250kHz
  *       Tick_period = 1 / 250kHz = 4us
  *       Ticks_for_1ms = 1ms / 4us = 250 ticks
- *       OCR0A = 250 - 1 = 249 (counter starts from 0)
+ *       MILLIS_OCR = 250 - 1 = 249 (counter starts from 0)
  * @note Global interrupts must be enabled separately after this function
  * ------------------------------------------------------- */
 void millis_Init(void)
 {
-    /* ===== Configure Timer0 for CTC Mode (Mode 2) ===== */
-    /* CTC Mode: WGM02:WGM00 = 010 */
-    bitClear(TCCR0A, WGM00);             /**< WGM00 = 0 for CTC mode */
-    bitSet  (TCCR0A, WGM01);             /**< WGM01 = 1 for CTC mode */
-    bitClear(TCCR0B, WGM02);             /**< WGM02 = 0 for CTC mode */
+#if MILLIS_AVR01
+#if MILLIS_RTC
+    /* ===== RTC counter, PER is the tick period ===== */
+    MILLIS_TIMSK = 0;                    /**< No RTC interrupt while the clock source changes */
+    millis_Async_Wait();
+    RTC.CTRLA = 0;                       /**< Stop, CLKSEL may only change while the RTC is disabled */
+    #if MILLIS_RTC_XTAL
+    _PROTECTED_WRITE(CLKCTRL.XOSC32KCTRLA, CLKCTRL_ENABLE_bm);  /**< Start the crystal oscillator on TOSC1/TOSC2 */
+    #endif
+    millis_Async_Wait();
+    RTC.CLKSEL = MILLIS_RTC_XTAL ? (2 << RTC_CLKSEL_gp) : (0 << RTC_CLKSEL_gp);   /**< TOSC32K or INT32K */
+#else
+    /* ===== TCBn in periodic interrupt mode, CCMP is the tick period ===== */
+    MILLIS_TCB_DEV.CTRLA = 0;            /**< Stop while the period changes */
+    MILLIS_TCB_DEV.CTRLB = TCB_CNTMODE_INT_gc;
+#endif
 
-    /* ===== Set Clock Prescaler to 64 ===== */
-    /* Prescaler 64: CS02:CS00 = 011 */
-    /* Timer frequency = 16MHz / 64 = 250kHz */
-    bitSet  (TCCR0B, CS00);              /**< CS00 = 1 for prescaler 64 */
-    bitSet  (TCCR0B, CS01);              /**< CS01 = 1 for prescaler 64 */
-    bitClear(TCCR0B, CS02);              /**< CS02 = 0 for prescaler 64 */
+#if MILLIS_RUNTIME_PERIOD
+    MILLIS_OCR  = millis_PeriodCompare;  /**< A trim from before a re-init stays in effect */
+#else
+    MILLIS_OCR  = MILLIS_COMPARE;        /**< MILLIS_TIMER_COUNTS states per tick (0..MILLIS_COMPARE) */
+#endif
+    MILLIS_TCNT = 0;                     /**< Start the first tick from a clean count */
+    MILLIS_ISR_ACK();                    /**< Clear a pending flag before enabling */
+    bitSet(MILLIS_TIMSK, MILLIS_OCIE);   /**< Enable the tick interrupt */
 
-    /* ===== Enable Compare Match A Interrupt ===== */
-    bitSet(TIMSK0, OCIE0A);              /**< Enable interrupt on compare match with OCR0A */
+#if MILLIS_RTC
+    RTC.CTRLA = MILLIS_CLOCK_SELECT | RTC_RUNSTDBY_bm | RTC_RTCEN_bm;
+    millis_Async_Wait();                 /**< Let the new settings reach the RTC clock domain */
+#else
+    MILLIS_TCB_DEV.CTRLA = MILLIS_CLOCK_SELECT | TCB_ENABLE_bm;
+#endif
+#else
+#if MILLIS_RTC
+    /* ===== Switch Timer2 to the 32.768kHz crystal ===== */
+    bitClear(TIMSK2, OCIE2A);            /**< No Timer2 interrupt while the clock source changes */
+    #ifdef EXCLK
+    bitClear(ASSR, EXCLK);               /**< Crystal oscillator on TOSC1/TOSC2, not an external clock */
+    #endif
+    bitSet(ASSR, AS2);                   /**< Clock Timer2 asynchronously from TOSC1 */
+#endif
+
+#if MILLIS_PWM
+    /* ===== Configure the tick timer for Fast PWM (Mode 3, TOP = 0xFF) ===== */
+    /* COMnx output bits and OCRnA/OCRnB are left to the application */
+    MILLIS_TCCRA = (MILLIS_TCCRA & ~MILLIS_WGM_A_MASK) | MILLIS_WGM_A;
+#else
+    /* ===== Configure the tick timer for CTC Mode (Mode 2, Mode 4 on 16-bit timers) ===== */
+    /* Each control register is written once, asynchronous Timer2
+       registers must not be rewritten before they are synchronised */
+    MILLIS_TCCRA = (MILLIS_TCCRA & ~MILLIS_WGM_A_MASK) | MILLIS_WGM_A;
+
+    /* ===== Set Compare Match Value for one Tick ===== */
+#if MILLIS_TICK_RATE
+    millis_PeriodCompare = (millis_Count_T)((MILLIS_CAL_NOMINAL >> 16) - 1);    /**< Back to MILLIS_TICK_HZ */
+    millis_PeriodRem     = (uint16_t)MILLIS_CAL_NOMINAL;
+    millis_PeriodAcc     = 0;
+    millis_PeriodOwe     = 0;
+    millis_RateShift     = MILLIS_PRESCALER_SHIFT;
+    millis_UsScale       = MILLIS_US_SCALE;
+    millis_TickHz        = MILLIS_TICK_HZ;
+    millis_TickMs        = MILLIS_MS_PER_TICK;
+    millis_TickUsRem     = 0;
+    millis_TickAcc       = 0;
+    millis_RatePending   = false;
+#endif
+#if MILLIS_RUNTIME_PERIOD
+    MILLIS_OCR  = millis_PeriodCompare;  /**< A trim from before a re-init stays in effect */
+#else
+    MILLIS_OCR  = MILLIS_COMPARE;        /**< MILLIS_TIMER_COUNTS states per tick (0..MILLIS_COMPARE) */
+#endif
+#endif
+    MILLIS_TCNT = 0;                     /**< Start the first tick from a clean count */
 
+    /* ===== Set Clock Prescaler ===== */
+    /* Timer frequency = MILLIS_TIMER_HZ / MILLIS_PRESCALER, upper WGM bits for CTC mode */
+    MILLIS_TCCRB = (MILLIS_TCCRB & ~(MILLIS_WGM_B_MASK | MILLIS_CS_MASK)) | MILLIS_WGM_B | MILLIS_CLOCK_SELECT;
+
+#if MILLIS_RTC
+    millis_Async_Wait();                 /**< Let the new settings reach the crystal clock domain */
+#endif
+
+#if MILLIS_PWM
+    /* ===== Clear and Enable the Overflow Interrupt ===== */
+    intFlag_clear(MILLIS_TIFR, MILLIS_TOV);  /**< Clear any pending overflow flag before enabling */
+    bitSet(MILLIS_TIMSK, MILLIS_TOIE);   /**< Enable interrupt on timer overflow */
+#else
     /* ===== Clear Compare Match A Interrupt Flag ===== */
-    intFlag_clear(TIFR0, OCF0A);         /**< Clear any pending interrupt flag before enabling */
+    intFlag_clear(MILLIS_TIFR, MILLIS_OCF);  /**< Clear any pending interrupt flag before enabling */
+
+    /* ===== Enable Compare Match A Interrupt ===== */
+    bitSet(MILLIS_TIMSK, MILLIS_OCIE);   /**< Enable interrupt on compare match with the tick compare value */
+#endif
+#endif /* MILLIS_AVR01 */
+};
+
+
+/* ============================================================================
+ *                         TIMESTAMP FUNCTIONS
+ * ============================================================================ */
+
+#if MILLIS_PWM
+/* -------------------------------------------------------
+ * @brief Capture a raw timestamp (MILLIS_PWM = 1)
+ * @param Stamp Receives System_millis, the counter and the accumulator
+ * @retval None
+ * @note System_millis, the accumulator and the counter are sampled with
+ *       interrupts disabled. A pending overflow with the counter already
+ *       wrapped is added here, as in the CTC version
+ * ------------------------------------------------------- */
+void millis_Stamp(millis_Stamp_T *Stamp)
+{
+    uint32_t _Millis;
+    millis_Count_T _Count;
+    uint8_t  _Sreg = SREG;               /**< Save interrupt state, safe to call from ISR */
+#if MILLIS_PWM_FRACT
+    millis_Fract_T _Acc;
+#endif
+
+    cli();
+    _Millis = System_millis;
+    _Count  = MILLIS_TCNT;
+#if MILLIS_PWM_FRACT
+    _Acc    = millis_FractAcc;
+#endif
+    if (bit_is_set(MILLIS_TIFR, MILLIS_TOV) && (_Count < MILLIS_COUNTER_MAX))
+    {
+#if MILLIS_PWM_FRACT
+        _Millis += MILLIS_PWM_MS + millis_Fract_Step(&_Acc);     /**< Overflow pending and counter already wrapped */
+#else
+        _Millis += MILLIS_PWM_MS;        /**< Overflow pending and counter already wrapped */
+#endif
+    }
+    SREG = _Sreg;                        /**< Restore interrupt state */
+
+    Stamp->Millis = _Millis;
+    Stamp->Count  = _Count;
+#if MILLIS_PWM_FRACT
+    Stamp->Acc    = _Acc;
+#endif
+};
+
+/* -------------------------------------------------------
+ * @brief Convert a raw timestamp to microseconds (MILLIS_PWM = 1)
+ * @param Stamp Timestamp taken by millis_Stamp
+ * @retval Microseconds since millis_Init
+ * @note The carried fraction is converted with MILLIS_FRACT_US, a 10.22
+ *       fixed-point constant, so no division is needed. Both parts are
+ *       rounded down, so with a count shorter than 2us (prescaler 1 or 8
+ *       at 16MHz) a reading right after an overflow can be up to 2us
+ *       below the one read right before it
+ * ------------------------------------------------------- */
+uint32_t millis_Stamp_Us(const millis_Stamp_T *Stamp)
+{
+    uint32_t _Us = (Stamp->Millis * 1000UL) + (((uint32_t)Stamp->Count * MILLIS_US_SCALE) >> MILLIS_US_SHIFT);
+
+#if MILLIS_PWM_FRACT
+    _Us += ((uint32_t)Stamp->Acc * MILLIS_FRACT_US) >> 22;     /**< Fraction of a ms carried by the accumulator */
+#endif
+    return _Us;
+};
+#else
+/* -------------------------------------------------------
+ * @brief Capture a raw timestamp
+ * @param Stamp Receives System_millis and the count into the running tick
+ * @retval None
+ * @note System_millis and MILLIS_TCNT are sampled with interrupts disabled
+ *       so both belong to the same millisecond
+ * @note If MILLIS_OCF is already set the ISR is pending and System_millis
+ *       is one tick behind. MILLIS_TCNT below MILLIS_OCR then means the
+ *       counter has already wrapped, so the pending tick is added here.
+ *       MILLIS_TCNT equal to MILLIS_OCR was read just before the wrap and
+ *       needs no correction. The live MILLIS_OCR is used because drift
+ *       correction and tickless sleep windows change it. Inside a sleep
+ *       window MILLIS_TCNT counts from the window start, so the result
+ *       stays correct there too. After an early wake the tick in progress
+ *       starts at millis_PeriodBase.
+ * ------------------------------------------------------- */
+void millis_Stamp(millis_Stamp_T *Stamp)
+{
+    uint32_t _Millis;
+    millis_Count_T _Count;
+#if MILLIS_TICK_RATE
+    uint16_t _Us;
+#endif
+    uint8_t  _Sreg = SREG;               /**< Save interrupt state, safe to call from ISR */
+
+    cli();
+    _Millis = System_millis;
+#if MILLIS_TICK_RATE
+    _Us     = millis_TickAcc;
+#endif
+    _Count  = MILLIS_TCNT;
+    if (bit_is_set(MILLIS_TIFR, MILLIS_OCF) && (_Count < MILLIS_OCR))
+    {
+#if MILLIS_TICKLESS
+        _Millis += (uint16_t)millis_Span * MILLIS_MS_PER_TICK;  /**< Pending end of a sleep window */
+#elif MILLIS_TICK_RATE
+        _Millis += millis_TickMs;        /**< Pending tick at the rate in effect */
+        _Us     += millis_TickUsRem;
+#else
+        _Millis += MILLIS_MS_PER_TICK;   /**< Compare match pending and counter already wrapped */
+#endif
+    }
+#if MILLIS_TICKLESS
+    else
+    {
+        _Count -= millis_PeriodBase;     /**< Tick in progress after an early wake did not start at 0 */
+    }
+#endif
+    SREG = _Sreg;                        /**< Restore interrupt state */
+
+    Stamp->Millis = _Millis;
+#if MILLIS_TICK_RATE
+    Stamp->Us     = _Us;
+#endif
+    Stamp->Count  = _Count;
+};
+
+/* -------------------------------------------------------
+ * @brief Convert a raw timestamp to microseconds
+ * @param Stamp Timestamp taken by millis_Stamp
+ * @retval Microseconds since millis_Init
+ * ------------------------------------------------------- */
+uint32_t millis_Stamp_Us(const millis_Stamp_T *Stamp)
+{
+#if MILLIS_TICK_RATE
+    return (Stamp->Millis * 1000UL) + Stamp->Us + (((uint32_t)Stamp->Count * millis_UsScale) >> 8);
+#elif MILLIS_CALIBRATE
+    return (Stamp->Millis * 1000UL) + (((uint32_t)Stamp->Count * millis_UsScale) >> MILLIS_US_SHIFT);    /**< Count stays below one trimmed tick */
+#elif MILLIS_US_WIDE
+    return (Stamp->Millis * 1000UL) + (uint32_t)(((uint64_t)Stamp->Count * MILLIS_US_SCALE) >> MILLIS_US_SHIFT);
+#else
+    return (Stamp->Millis * 1000UL) + (((uint32_t)Stamp->Count * MILLIS_US_SCALE) >> MILLIS_US_SHIFT);
+#endif
+};
+#endif /* MILLIS_PWM */
+
+/* -------------------------------------------------------
+ * @brief Read microsecond timestamp
+ * @retval Microseconds since millis_Init
+ * @note Capture and conversion are split so that probes can take the
+ *       cheap capture in a timed section and convert later
+ * ------------------------------------------------------- */
+uint32_t micros(void)
+{
+    millis_Stamp_T _Stamp;
+
+    millis_Stamp(&_Stamp);
+    return millis_Stamp_Us(&_Stamp);
+};
+
+
+#if MILLIS_UPTIME
+/* -------------------------------------------------------
+ * @brief Read the uptime split into seconds and milliseconds
+ * @param Ms Receives the milliseconds of the running second (may be NULL)
+ * @retval Seconds since millis_Init
+ * @note One epoch is 2^32 ms = 4294967 s + 296 ms, so
+ *       seconds = Epoch * 4294967 + Low / 1000 + (Epoch * 296 + Low % 1000) / 1000.
+ *       Epoch * 296 + 999 stays below 2^25, all terms fit 32 bits
+ * ------------------------------------------------------- */
+uint32_t millis_Uptime(uint16_t *Ms)
+{
+    uint64_t _Now   = millis64();
+    uint16_t _Epoch = (uint16_t)(_Now >> 32);
+    uint32_t _Low   = (uint32_t)_Now;
+    uint32_t _Rest  = ((uint32_t)_Epoch * 296UL) + (_Low % 1000UL);  /**< Milliseconds not yet in whole seconds */
+
+    if (Ms)
+    {
+        *Ms = (uint16_t)(_Rest % 1000UL);
+    }
+    return ((uint32_t)_Epoch * 4294967UL) + (_Low / 1000UL) + (_Rest / 1000UL);
+};
+#endif
+
+
+#if MILLIS_ISR_TASKS
+/* ============================================================================
+ *                         ISR CALLBACK FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Run a callback from the tick ISR every Period milliseconds
+ * @param Slot     Callback slot, 0..MILLIS_ISR_TASKS-1
+ * @param Callback Function to call in ISR context
+ * @param Period   Period in milliseconds
+ * @retval true if the slot was set up, false if Slot is out of range
+ * @note The slot is written with interrupts disabled, so the ISR never
+ *       sees a half-written entry
+ * ------------------------------------------------------- */
+bool millis_IsrTask_Start(uint8_t Slot, void (*Callback)(void), uint16_t Period)
+{
+    uint16_t _Ticks = Period / MILLIS_MS_PER_TICK;
+    uint8_t  _Sreg  = SREG;
+
+    if (Slot >= MILLIS_ISR_TASKS)
+    {
+        return false;
+    }
+    if (_Ticks == 0)
+    {
+        _Ticks = 1;                      /**< Shortest period is one tick */
+    }
+
+    cli();
+    millis_IsrTasks[Slot].Period    = _Ticks;
+    millis_IsrTasks[Slot].Countdown = _Ticks;
+    millis_IsrTasks[Slot].Callback  = Callback;
+    SREG = _Sreg;
+    return true;
+};
+
+/* -------------------------------------------------------
+ * @brief Release an ISR callback slot
+ * @param Slot Callback slot, 0..MILLIS_ISR_TASKS-1
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_IsrTask_Stop(uint8_t Slot)
+{
+    uint8_t _Sreg = SREG;
+
+    if (Slot < MILLIS_ISR_TASKS)
+    {
+        cli();
+        millis_IsrTasks[Slot].Callback = NULL;
+        SREG = _Sreg;
+    }
+};
+#endif
+
+
+#if MILLIS_WATCHDOG
+/* ============================================================================
+ *                         WATCHDOG FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Disable the hardware watchdog right after a reset
+ * @retval None
+ * @note After a watchdog reset the watchdog stays enabled at its
+ *       shortest time-out, and WDRF must be cleared before WDE can be.
+ *       MCUSR is copied first, so the reset cause is not lost.
+ *       Runs from .init3, before .data and .bss are set up and long
+ *       before main
+ * ------------------------------------------------------- */
+static void millis_Watchdog_Boot(void) __attribute__((naked, used, section(".init3")));
+static void millis_Watchdog_Boot(void)
+{
+#ifdef MCUSR
+    millis_ResetFlags = MCUSR;
+    MCUSR &= ~(1 << WDRF);
+#elif MILLIS_AVR01
+    millis_ResetFlags = RSTCTRL.RSTFR;   /**< No WDRF interlock here, the flags stay for the application */
+#else
+    millis_ResetFlags = 0;
+#endif
+    wdt_disable();
+};
+
+#if defined(WDTCSR) && defined(WDIE)
+/* -------------------------------------------------------
+ * @brief Watchdog interrupt, first stage of the deadline reset
+ * @retval None (never returns, the next time-out resets the device)
+ * @note Naked, so the stack pointer still points just below the return
+ *       address, which is the code the main loop was running. The
+ *       return address is a word address, high byte first from SP+1.
+ *       Nothing is saved because the device resets anyway
+ * @note One basic asm block, a naked function has no frame for C code.
+ *       Pc sits at byte 3 of millis_WdgLast (after Magic and Task, AVR
+ *       structs are not padded) and is stored little-endian, shifted
+ *       left once to make the byte address
+ * ------------------------------------------------------- */
+ISR(WDT_vect, ISR_NAKED)
+{
+    __asm__ __volatile__
+    (
+        "clr  __zero_reg__                  \n\t"
+        "in   r30, __SP_L__                 \n\t"
+#if defined(__AVR_HAVE_8BIT_SP__)
+        "clr  r31                           \n\t"   /* No SPH on this device */
+#else
+        "in   r31, __SP_H__                 \n\t"
+#endif
+#if defined(__AVR_3_BYTE_PC__)
+        "ldd  r25, Z+3                      \n\t"   /* Return address bits 7..0 */
+        "ldd  r24, Z+2                      \n\t"   /* Bits 15..8 */
+        "ldd  r23, Z+1                      \n\t"   /* Bits 23..16 */
+        "lsl  r25                           \n\t"   /* Word to byte address */
+        "rol  r24                           \n\t"
+        "rol  r23                           \n\t"
+        "clr  r22                           \n\t"
+        "rol  r22                           \n\t"
+        "sts  millis_WdgLast+3, r25         \n\t"
+        "sts  millis_WdgLast+4, r24         \n\t"
+        "sts  millis_WdgLast+5, r23         \n\t"
+        "sts  millis_WdgLast+6, r22         \n\t"
+#else
+        "ldd  r25, Z+2                      \n\t"   /* Return address low byte */
+        "ldd  r24, Z+1                      \n\t"   /* High byte */
+        "lsl  r25                           \n\t"   /* Word to byte address */
+        "rol  r24                           \n\t"
+        "clr  r23                           \n\t"
+        "rol  r23                           \n\t"
+        "sts  millis_WdgLast+3, r25         \n\t"
+        "sts  millis_WdgLast+4, r24         \n\t"
+        "sts  millis_WdgLast+5, r23         \n\t"
+        "sts  millis_WdgLast+6, __zero_reg__\n\t"
+#endif
+        "1:                                 \n\t"
+        "rjmp 1b                            \n\t"   /* WDIE was cleared by this interrupt, the next time-out resets */
+    );
+};
+#endif
+
+/* -------------------------------------------------------
+ * @brief Start monitoring a main-loop task
+ * @param Id     Task ID, 0..MILLIS_WATCHDOG-1
+ * @param Budget Longest time in milliseconds between two kicks
+ * @retval true if started, false if Id is out of range or Budget is 0
+ * @note One extra tick covers the partial tick the budget starts in
+ * ------------------------------------------------------- */
+bool millis_Watchdog_Start(uint8_t Id, uint16_t Budget)
+{
+    uint32_t _Ticks = ((Budget + MILLIS_MS_PER_TICK - 1) / MILLIS_MS_PER_TICK) + 1;
+    uint8_t  _Sreg  = SREG;
+
+    if ((Id >= MILLIS_WATCHDOG) || (Budget == 0))
+    {
+        return false;
+    }
+    if (_Ticks > UINT16_MAX)
+    {
+        _Ticks = UINT16_MAX;
+    }
+
+    cli();
+    millis_Wdg[Id].Budget    = (uint16_t)_Ticks;
+    millis_Wdg[Id].Countdown = (uint16_t)_Ticks;
+    SREG = _Sreg;
+    return true;
+};
+
+/* -------------------------------------------------------
+ * @brief Restart the deadline of a task
+ * @param Id Task ID, 0..MILLIS_WATCHDOG-1
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Watchdog_Kick(uint8_t Id)
+{
+    uint8_t _Sreg = SREG;
+
+    if (Id < MILLIS_WATCHDOG)
+    {
+        cli();
+        millis_Wdg[Id].Countdown = millis_Wdg[Id].Budget;
+        SREG = _Sreg;
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief Stop monitoring a task
+ * @param Id Task ID, 0..MILLIS_WATCHDOG-1
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Watchdog_Stop(uint8_t Id)
+{
+    uint8_t _Sreg = SREG;
+
+    if (Id < MILLIS_WATCHDOG)
+    {
+        cli();
+        millis_Wdg[Id].Budget    = 0;
+        millis_Wdg[Id].Countdown = 0;
+        SREG = _Sreg;
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief Read the record of the last deadline reset
+ * @param Report Receives the record
+ * @retval true if the last reset was a deadline reset
+ * @note After power-up .noinit holds random data, the magic value and
+ *       the task range make a false report unlikely
+ * ------------------------------------------------------- */
+bool millis_Watchdog_Report(millis_WdgReport_T *Report)
+{
+    if ((millis_WdgLast.Magic != MILLIS_WDG_MAGIC) || (millis_WdgLast.Task >= MILLIS_WATCHDOG))
+    {
+        return false;
+    }
+
+    *Report = millis_WdgLast;
+    millis_WdgLast.Magic = 0;            /**< Report every reset once */
+    return true;
+};
+
+/* -------------------------------------------------------
+ * @brief Reset cause flags of the last reset
+ * @retval MCUSR (RSTCTRL.RSTFR on AVR-0/1) as it was before .init3
+ *         cleared WDRF
+ * ------------------------------------------------------- */
+uint8_t millis_Watchdog_ResetFlags(void)
+{
+    return millis_ResetFlags;
+};
+#endif
+
+
+#if MILLIS_ISR_STATS
+/* ============================================================================
+ *                         ISR STATISTICS FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Copy the tick ISR statistics
+ * @param Stats Receives a consistent copy
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_IsrStats_Get(millis_IsrStats_T *Stats)
+{
+    uint8_t _Sreg = SREG;
+
+    cli();
+    *Stats = millis_IsrStats;
+    SREG = _Sreg;
+};
+
+/* -------------------------------------------------------
+ * @brief Clear the tick ISR statistics
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_IsrStats_Reset(void)
+{
+    uint8_t _Sreg = SREG;
+
+    cli();
+    millis_IsrStats.Busy       = 0;
+    millis_IsrStats.Periods    = 0;
+    millis_IsrStats.Calls      = 0;
+    millis_IsrStats.MaxBusy    = 0;
+    millis_IsrStats.MaxLatency = 0;
+    SREG = _Sreg;
+};
+
+/* -------------------------------------------------------
+ * @brief CPU load of the tick ISR since the last reset
+ * @retval Load in 0.01% units, 0..10000
+ * @note Both terms are halved until the total fits 18 bits, then
+ *       Busy * 10000 fits 32 bits without a 64-bit division
+ * ------------------------------------------------------- */
+uint16_t millis_IsrLoad(void)
+{
+    millis_IsrStats_T _Stats;
+    uint32_t _Busy;
+    uint32_t _Total;
+    uint8_t  _Shift = 0;
+
+    millis_IsrStats_Get(&_Stats);
+    _Busy  = _Stats.Busy;
+    _Total = _Stats.Periods;
+    if (_Total == 0)
+    {
+        return 0;
+    }
+
+    while (_Total > (0xFFFFFFFFUL / MILLIS_PERIOD_COUNTS))
+    {
+        _Total >>= 1;                    /**< Keep Periods * MILLIS_PERIOD_COUNTS in 32 bits */
+        _Shift++;
+    }
+    _Total *= MILLIS_PERIOD_COUNTS;
+    _Busy >>= _Shift;
+    while (_Total > 0x3FFFFUL)
+    {
+        _Total >>= 1;
+        _Busy  >>= 1;
+    }
+    if (_Busy >= _Total)
+    {
+        return 10000;
+    }
+    return (uint16_t)((_Busy * 10000UL) / _Total);
+};
+#endif
+
+
+#if MILLIS_MISSED
+/* ============================================================================
+ *                         MISSED TICK FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Number of ticks served late since the last reset
+ * @retval Late ticks, saturates at 65535
+ * ------------------------------------------------------- */
+uint16_t millis_Missed(void)
+{
+    uint16_t _Count;
+    uint8_t  _Sreg = SREG;
+
+    cli();
+    _Count = millis_MissedCount;
+    SREG = _Sreg;
+    return _Count;
+};
+
+/* -------------------------------------------------------
+ * @brief Clear the late tick counter
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Missed_Reset(void)
+{
+    uint8_t _Sreg = SREG;
+
+    cli();
+    millis_MissedCount = 0;
+    SREG = _Sreg;
+};
+#endif
+
+/* -------------------------------------------------------
+ * @brief Add milliseconds that were lost to System_millis
+ * @param Ms Milliseconds to add
+ * @retval None
+ * @note Goes through millis_Advance, so the MILLIS_UPTIME epoch follows
+ * ------------------------------------------------------- */
+void millis_Catchup(uint16_t Ms)
+{
+    uint8_t _Sreg = SREG;
+
+    cli();
+    millis_Advance(Ms);
+    SREG = _Sreg;
+};
+
+
+#if MILLIS_TICK_RATE
+/* ============================================================================
+ *                         TICK RATE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Switch the tick rate
+ * @param Hz New tick rate, 1000000 / Hz must be a whole number
+ * @retval true if accepted, false if the rate can not be reached
+ * @note The prescaler table follows the timer, Timer2 has /32 and /128.
+ *       Clock select n + 1 picks entry n on every AVR tick timer
+ * ------------------------------------------------------- */
+bool millis_SetTickRate(uint16_t Hz)
+{
+#if MILLIS_TIMER == 2
+    static const uint8_t _Shift[] = {0, 3, 5, 6, 7, 8, 10};  /**< log2 of /1, /8, /32, /64, /128, /256, /1024 */
+#else
+    static const uint8_t _Shift[] = {0, 3, 6, 8, 10};        /**< log2 of /1, /8, /64, /256, /1024 */
+#endif
+    millis_Rate_T _Rate;
+    uint32_t _TickUs;
+    uint8_t  _Sreg = SREG;
+
+    if ((Hz == 0) || ((1000000UL % Hz) != 0) || (((MILLIS_TIMER_HZ) / Hz) < 256))
+    {
+        return false;                    /**< No whole microsecond period, or no time left for the ISR */
+    }
+    _TickUs = 1000000UL / Hz;
+
+    for (uint8_t _Cs = 0; _Cs < sizeof(_Shift); _Cs++)
+    {
+        uint32_t _Period = (uint32_t)(((uint64_t)(MILLIS_TIMER_HZ) << 16) / ((uint32_t)Hz << _Shift[_Cs]));
+
+        if (((_Period >> 16) + ((_Period & 0xFFFF) != 0)) > MILLIS_COUNTER_MAX)
+        {
+            continue;                    /**< Long period does not fit the counter, try a larger prescaler */
+        }
+
+        _Rate.Compare = (millis_Count_T)((_Period >> 16) - 1);
+        _Rate.Rem     = (uint16_t)_Period;
+        _Rate.Cs      = (uint8_t)((_Cs + 1) << MILLIS_CS0);
+        _Rate.Shift   = _Shift[_Cs];
+        _Rate.Scale   = (uint32_t)((256000000ULL << _Shift[_Cs]) / (MILLIS_TIMER_HZ));
+        _Rate.Hz      = Hz;
+        _Rate.Ms      = (uint16_t)(_TickUs / 1000);
+        _Rate.UsRem   = (uint16_t)(_TickUs % 1000);
+
+        cli();
+        millis_RateNext    = _Rate;
+        millis_RatePending = true;       /**< Taken over by the next tick ISR */
+        SREG = _Sreg;
+        return true;
+    }
+    return false;
+};
+
+/* -------------------------------------------------------
+ * @brief Tick rate in effect
+ * @retval Tick interrupts per second
+ * ------------------------------------------------------- */
+uint16_t millis_TickRate(void)
+{
+    uint16_t _Hz;
+    uint8_t  _Sreg = SREG;
+
+    cli();
+    _Hz = millis_TickHz;
+    SREG = _Sreg;
+    return _Hz;
+};
+#endif
+
+
+#if MILLIS_CALIBRATE
+/* ============================================================================
+ *                         CALIBRATION FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Error of the local clock in ppm
+ * @note Positive when LocalUs is longer than RefUs (local clock fast)
+ * ------------------------------------------------------- */
+static int32_t millis_Calibrate_Ppm(uint32_t RefUs, uint32_t LocalUs)
+{
+    int64_t _Ppm = (((int64_t)LocalUs - (int64_t)RefUs) * 1000000LL) / (int64_t)RefUs;
+
+    if (_Ppm > INT32_MAX)
+    {
+        return INT32_MAX;
+    }
+    if (_Ppm < INT32_MIN)
+    {
+        return INT32_MIN;
+    }
+    return (int32_t)_Ppm;
+};
+
+/* -------------------------------------------------------
+ * @brief Read the trimmed tick period
+ * @retval Timer counts per tick in 16.16 fixed point
+ * ------------------------------------------------------- */
+uint32_t millis_Calibrate_Get(void)
+{
+    uint32_t _Period;
+    uint8_t  _Sreg = SREG;
+
+    cli();
+    _Period = (((uint32_t)millis_PeriodCompare + 1) << 16) + millis_PeriodRem;
+    SREG = _Sreg;
+    return _Period;
+};
+
+/* -------------------------------------------------------
+ * @brief Set the tick period directly
+ * @param Period Timer counts per tick in 16.16 fixed point
+ * @retval None
+ * @note The micros() scale is 1000us * MILLIS_MS_PER_TICK per period with
+ *       MILLIS_US_SHIFT fraction bits. The 64-bit division runs here,
+ *       never in micros()
+ * ------------------------------------------------------- */
+void millis_Calibrate_Set(uint32_t Period)
+{
+    const uint32_t _Min = MILLIS_CAL_NOMINAL - (MILLIS_CAL_NOMINAL / 8);
+    const uint32_t _Max = MILLIS_CAL_NOMINAL + (MILLIS_CAL_NOMINAL / 8);
+    uint32_t _Scale;
+    uint8_t  _Sreg = SREG;
+
+    if (Period < _Min)
+    {
+        Period = _Min;
+    }
+    if (Period > _Max)
+    {
+        Period = _Max;                   /**< MILLIS_FITS_TRIM keeps the long period inside the counter */
+    }
+    _Scale = (uint32_t)((((uint64_t)MILLIS_MS_PER_TICK * (1000ULL << MILLIS_US_SHIFT)) << 16) / Period);
+
+    cli();
+    millis_PeriodCompare = (millis_Count_T)((Period >> 16) - 1);
+    millis_PeriodRem     = (uint16_t)Period;
+    millis_UsScale    = _Scale;
+    SREG = _Sreg;
+};
+
+/* -------------------------------------------------------
+ * @brief Trim the tick period from a reference measurement
+ * @param RefUs   True length of the interval in microseconds
+ * @param LocalUs Length of the same interval measured with micros()
+ * @retval Error of the local clock before the trim in ppm
+ * @note New period = old period * LocalUs / RefUs, done as
+ *       old + old * (LocalUs - RefUs) / RefUs so it fits 64 bits
+ * ------------------------------------------------------- */
+int32_t millis_Calibrate(uint32_t RefUs, uint32_t LocalUs)
+{
+    int64_t _Period;
+
+    if (RefUs == 0)
+    {
+        return 0;
+    }
+
+    _Period  = (int64_t)millis_Calibrate_Get();
+    _Period += (_Period * ((int64_t)LocalUs - (int64_t)RefUs)) / (int64_t)RefUs;
+    if (_Period < 0)
+    {
+        _Period = 0;                     /**< Clamped to the lower limit in millis_Calibrate_Set */
+    }
+    if (_Period > UINT32_MAX)
+    {
+        _Period = UINT32_MAX;
+    }
+    millis_Calibrate_Set((uint32_t)_Period);
+
+    return millis_Calibrate_Ppm(RefUs, LocalUs);
+};
+
+/* -------------------------------------------------------
+ * @brief Stamp a reference edge
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Calibrate_Stamp(void)
+{
+    uint32_t _Now = micros();            /**< First, so the edge latency stays constant */
+    uint8_t  _Sreg = SREG;
+
+    cli();
+    millis_CalStamp = _Now;
+    if (millis_CalEdges < 255)
+    {
+        millis_CalEdges++;
+    }
+    SREG = _Sreg;
+};
+
+/* -------------------------------------------------------
+ * @brief Calibrate from the stamped reference edges
+ * @param RefUs True time between two edges in microseconds
+ * @retval Error in ppm, 0 on the first edge, MILLIS_CAL_NO_EDGE without a new edge
+ * ------------------------------------------------------- */
+int32_t millis_Calibrate_Edge(uint32_t RefUs)
+{
+    uint32_t _Now;
+    uint32_t _Last;
+    uint8_t  _Edges;
+    uint8_t  _Sreg = SREG;
+
+    cli();
+    _Now   = millis_CalStamp;
+    _Edges = millis_CalEdges;
+    millis_CalEdges = 0;
+    SREG = _Sreg;
+
+    if (!_Edges)
+    {
+        return MILLIS_CAL_NO_EDGE;
+    }
+
+    _Last = millis_CalEdge;
+    millis_CalEdge = _Now;
+    if (!millis_CalEdgeValid || (_Edges == 255) || (RefUs > (UINT32_MAX / _Edges)))
+    {
+        millis_CalEdgeValid = true;      /**< First edge, or too many missed to count, start over from this one */
+        return 0;
+    }
+
+    return millis_Calibrate(RefUs * _Edges, _Now - _Last);
+};
+
+/* -------------------------------------------------------
+ * @brief Restart edge calibration with the next reference edge
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Calibrate_Restart(void)
+{
+    uint8_t _Sreg = SREG;
+
+    cli();
+    millis_CalEdgeValid = false;
+    millis_CalEdges     = 0;
+    SREG = _Sreg;
+};
+
+#ifdef OSCCAL
+/* -------------------------------------------------------
+ * @brief Step the internal RC oscillator towards a reference
+ * @param RefUs   True length of the interval in microseconds
+ * @param LocalUs Length of the same interval measured with micros()
+ * @retval Error of the local clock in ppm
+ * @note A higher OSCCAL gives a faster clock. The low seven bits are
+ *       stepped, bit 7 (range select) is never changed
+ * ------------------------------------------------------- */
+int32_t millis_Calibrate_Osc(uint32_t RefUs, uint32_t LocalUs)
+{
+    int32_t _Ppm;
+    uint8_t _Osc = OSCCAL;
+
+    if (RefUs == 0)
+    {
+        return 0;
+    }
+
+    _Ppm = millis_Calibrate_Ppm(RefUs, LocalUs);
+    if ((_Ppm > MILLIS_CAL_OSC_PPM) && ((_Osc & 0x7F) != 0x00))
+    {
+        OSCCAL = _Osc - 1;               /**< Local clock fast, slow the oscillator down */
+    }
+    else if ((_Ppm < -MILLIS_CAL_OSC_PPM) && ((_Osc & 0x7F) != 0x7F))
+    {
+        OSCCAL = _Osc + 1;               /**< Local clock slow, speed the oscillator up */
+    }
+    return _Ppm;
+};
+#endif
+#endif
+
+
+#if MILLIS_EVENTS
+/* ============================================================================
+ *                         EVENT FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Queue a handler to run in the main loop
+ * @param Handler Function to call from millis_Event_Dispatch
+ * @retval true if queued, false if the ring is full
+ * @note Head and tail run freely over 0..255 and are masked on access,
+ *       so Head - Tail is the fill level even across the wrap. Each
+ *       index is written by one side only and is a single byte, so no
+ *       lock is needed
+ * ------------------------------------------------------- */
+bool millis_Event_Post(void (*Handler)(void))
+{
+    uint8_t _Head = millis_EventHead;
+
+    if ((uint8_t)(_Head - millis_EventTail) >= MILLIS_EVENTS)
+    {
+        return false;                    /**< Full, the consumer is behind */
+    }
+    millis_Events[_Head & (MILLIS_EVENTS - 1)] = Handler;
+    millis_EventHead = _Head + 1;        /**< Publish after the slot is written */
+    return true;
+};
+
+/* -------------------------------------------------------
+ * @brief Run every queued handler in posting order
+ * @retval Number of handlers run
+ * @note The slot is read before the tail moves on, so the producer can
+ *       not overwrite a handler that is still being fetched
+ * ------------------------------------------------------- */
+uint8_t millis_Event_Dispatch(void)
+{
+    uint8_t _Tail = millis_EventTail;
+    uint8_t _Count = 0;
+
+    while (_Tail != millis_EventHead)
+    {
+        void (*_Handler)(void) = millis_Events[_Tail & (MILLIS_EVENTS - 1)];
+
+        millis_EventTail = ++_Tail;      /**< Free the slot before the handler runs */
+        _Handler();
+        _Count++;
+    }
+    return _Count;
+};
+#endif
+
+
+/* ============================================================================
+ *                         SCHEDULER FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Run every due task of a task table in one pass
+ * @param Tasks Pointer to the task table
+ * @param Count Number of entries in the task table
+ * @retval Milliseconds until the next task is due (0 = a task is due now)
+ * @note Deadlines are compared by subtraction, so counter rollover is safe
+ * @note Fixed-rate tasks keep Previous on their own grid, so Delta can be
+ *       non-zero right after they ran
+ * @note The nearest deadline is measured from the pass snapshot, then the
+ *       time spent in the callbacks is taken off before returning
+ * ------------------------------------------------------- */
+uint32_t millis_Scheduler(millis_Task_T *Tasks, uint8_t Count)
+{
+    uint32_t _Now  = millis();           /**< One snapshot for the whole pass */
+    uint32_t _Next = UINT32_MAX;         /**< Nearest deadline relative to _Now */
+    uint32_t _Remaining;
+    uint32_t _Spent;
+
+#if MILLIS_EVENTS
+    millis_Event_Dispatch();             /**< Deferred work from ISRs runs before the periodic tasks */
+#endif
+
+    for (uint8_t _Index = 0; _Index < Count; _Index++)
+    {
+        millis_T *_Timer = &Tasks[_Index].Timer;
+        bool _Due = millis_ExpiredAt(_Timer, _Now, Tasks[_Index].Mode);   /**< Re-armed before running, so the callback may change Interval */
+
+        _Timer->Delta = _Now - _Timer->Previous;  /**< 0 right after a fixed-delay re-arm */
+        if (_Due && Tasks[_Index].Callback)
+        {
+            Tasks[_Index].Callback();
+        }
+
+        _Remaining = (_Timer->Interval > _Timer->Delta) ? (_Timer->Interval - _Timer->Delta) : 0;
+        if (_Remaining < _Next)
+        {
+            _Next = _Remaining;
+        }
+    }
+
+    _Spent = millis() - _Now;            /**< Time taken by the callbacks of this pass */
+#if MILLIS_EVENTS
+    if (millis_EventTail != millis_EventHead)
+    {
+        return 0;                        /**< Posted during the pass, do not sleep on it */
+    }
+#endif
+    return (_Next > _Spent) ? (_Next - _Spent) : 0;
+};
+
+
+/* ============================================================================
+ *                         LOW POWER FUNCTIONS
+ * ============================================================================ */
+
+#if MILLIS_TICKLESS
+/* -------------------------------------------------------
+ * @brief Stretch the running period over the next ticks
+ * @param _Ticks Ticks until the requested wake-up (including the running one)
+ * @retval None
+ * @note Called and returns with interrupts disabled
+ * @note The window ends on a regular tick boundary, so the tick phase and
+ *       the drift correction sequence are kept: MILLIS_OCR moves from the top
+ *       of the running period to the top of the last covered period
+ * ------------------------------------------------------- */
+static void millis_Tickless_Enter(uint32_t _Ticks)
+{
+    millis_Count_T _Top = MILLIS_OCR;    /**< Top of the running period */
+    uint32_t _End = _Top;                /**< Top of the window, wide to catch counter overflow */
+    uint8_t  _Span = 1;
+    uint8_t  _Limit = (_Ticks < MILLIS_TICKLESS_MAX) ? (uint8_t)_Ticks : MILLIS_TICKLESS_MAX;
+
+    if ((_Limit < 2) || bit_is_set(MILLIS_TIFR, MILLIS_OCF))
+    {
+        return;                          /**< Wake-up within the running tick, or a tick pending for the ISR */
+    }
+
+#if MILLIS_FRACT_ACTIVE
+    millis_Fract_T _Acc = millis_FractAcc;
+
+    while (_Span < _Limit)
+    {
+        millis_Fract_T _Next = _Acc;
+        uint32_t _Len = MILLIS_TIMER_COUNTS + millis_Fract_Step(&_Next);
+
+        if ((_End + _Len) > MILLIS_COUNTER_MAX)
+        {
+            break;                       /**< Next period does not fit the counter */
+        }
+        _End += _Len;
+        _Acc  = _Next;
+        _Span++;
+    }
+#else
+    uint32_t _Room = (MILLIS_COUNTER_MAX - _Top) / MILLIS_TIMER_COUNTS;
+
+    if (_Room > (uint32_t)(_Limit - 1))
+    {
+        _Room = _Limit - 1;
+    }
+    _End  += _Room * MILLIS_TIMER_COUNTS;
+    _Span += (uint8_t)_Room;
+#endif
+
+    if (_Span < 2)
+    {
+        return;                          /**< No whole tick fits, sleep to the next tick */
+    }
+
+    MILLIS_OCR = (millis_Count_T)_End;
+    if (bit_is_set(MILLIS_TIFR, MILLIS_OCF))
+    {
+        return;                          /**< Running period ended before the write, the ISR rewrites the compare value */
+    }
+
+    millis_WindowTop = _Top;
+#if MILLIS_FRACT_ACTIVE
+    millis_WindowAcc = millis_FractAcc;
+    millis_FractAcc  = _Acc;             /**< Decisions of the covered periods are taken now */
+#endif
+    millis_Span = _Span;
+};
+
+/* -------------------------------------------------------
+ * @brief End a sleep window early and catch System_millis up
+ * @retval None
+ * @note Called and returns with interrupts disabled
+ * @note Counts the ticks that have fully elapsed inside the window, adds
+ *       them to System_millis and moves MILLIS_OCR to the end of the tick in
+ *       progress, so normal ticking resumes on the same phase. The start
+ *       count of that tick is kept for micros()
+ * @note If the counter passes the new top while it is being written, the
+ *       window end is restored and the catch-up is repeated
+ * ------------------------------------------------------- */
+static void millis_Tickless_Exit(void)
+{
+    millis_Count_T _End = MILLIS_OCR;    /**< Top of the window, restored on retry */
+
+    while ((millis_Span > 1) && !bit_is_set(MILLIS_TIFR, MILLIS_OCF))
+    {
+        millis_Count_T _Count = MILLIS_TCNT;
+        uint32_t _Top   = millis_WindowTop;
+        uint32_t _Base  = millis_PeriodBase;  /**< Start count of the tick in progress */
+        uint8_t  _Ticks = 0;
+
+        if (bit_is_set(MILLIS_TIFR, MILLIS_OCF))
+        {
+            return;                      /**< Window ended before the counter was read, the ISR adds it all */
+        }
+#if MILLIS_FRACT_ACTIVE
+        millis_Fract_T _Acc = millis_WindowAcc;
+
+        while (_Count > _Top)
+        {
+            _Ticks++;
+            _Base = _Top + 1;
+            _Top += MILLIS_TIMER_COUNTS + millis_Fract_Step(&_Acc);
+        }
+#else
+        if (_Count > _Top)
+        {
+            _Ticks = (uint8_t)(((_Count - _Top - 1) / MILLIS_TIMER_COUNTS) + 1);
+            _Top  += (uint32_t)_Ticks * MILLIS_TIMER_COUNTS;
+            _Base  = _Top + 1 - MILLIS_TIMER_COUNTS;
+        }
+#endif
+
+        MILLIS_OCR = (millis_Count_T)_Top;
+        if (bit_is_set(MILLIS_TIFR, MILLIS_OCF) || (MILLIS_TCNT <= MILLIS_OCR))
+        {
+            millis_Advance((millis_Step_T)_Ticks * MILLIS_MS_PER_TICK);   /**< Ticks elapsed inside the window */
+#if MILLIS_WATCHDOG
+            millis_Watchdog_Run(_Ticks); /**< Count down only, the window ends before any deadline */
+#endif
+#if MILLIS_ISR_TASKS
+            millis_IsrTask_Run(_Ticks);  /**< Count down only, the window ends before any slot is due */
+#endif
+#if MILLIS_FRACT_ACTIVE
+            millis_FractAcc = _Acc;      /**< Sequence continues after the tick in progress */
+#endif
+            millis_PeriodBase = (millis_Count_T)_Base;
+            millis_Span       = 1;
+            return;
+        }
+        MILLIS_OCR = _End;               /**< Counter passed the new top, keep the window and retry */
+    }
+};
+#endif
+
+/* -------------------------------------------------------
+ * @brief Sleep until a timeout elapses or any interrupt wakes the CPU
+ * @param Timeout   Longest sleep in milliseconds (0 = return at once)
+ * @param Condition Checked with interrupts disabled before going to
+ *                  sleep, NULL = always sleep
+ * @retval true if Condition was met and the CPU did not sleep
+ * @note Interrupts are enabled by the SEI right before SLEEP, the AVR
+ *       always executes the next instruction first, so a wake-up
+ *       interrupt can not slip in between and be missed. An ISR that
+ *       makes Condition true after the check therefore always wakes
+ *       the CPU again
+ * ------------------------------------------------------- */
+static bool millis_Sleep(uint32_t Timeout, bool (*Condition)(void))
+{
+    if (Timeout == 0)
+    {
+        return false;
+    }
+
+    set_sleep_mode(MILLIS_SLEEP_MODE);
+    cli();
+    if (Condition && Condition())
+    {
+        sei();
+        return true;                     /**< Already met, do not start a sleep (or a sleep window) */
+    }
+#if MILLIS_TICKLESS
+    uint32_t _Ticks = Timeout / MILLIS_MS_PER_TICK;
+
+    #if MILLIS_ISR_TASKS
+    for (uint8_t _Slot = 0; _Slot < MILLIS_ISR_TASKS; _Slot++)
+    {
+        if (millis_IsrTasks[_Slot].Callback && (millis_IsrTasks[_Slot].Countdown < _Ticks))
+        {
+            _Ticks = millis_IsrTasks[_Slot].Countdown;   /**< Wake on the tick the callback is due */
+        }
+    }
+    #endif
+    #if MILLIS_WATCHDOG
+    for (uint8_t _Id = 0; _Id < MILLIS_WATCHDOG; _Id++)
+    {
+        if (millis_Wdg[_Id].Countdown && (millis_Wdg[_Id].Countdown < _Ticks))
+        {
+            _Ticks = millis_Wdg[_Id].Countdown;  /**< Wake on the tick the deadline expires */
+        }
+    }
+    #endif
+    millis_Tickless_Enter(_Ticks);
+#endif
+#if MILLIS_RTC
+    millis_Async_Wait();                 /**< A pending OCR2A update from the tick ISR would be lost in power-save */
+#endif
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+#if MILLIS_RTC && !MILLIS_AVR01
+    TCCR2A = TCCR2A;                     /**< Dummy write, its transfer takes at least one TOSC1 cycle */
+    millis_Async_Wait();                 /**< TCNT2 is not valid right after a wake-up from power-save */
+#endif
+#if MILLIS_TICKLESS
+    cli();
+    millis_Tickless_Exit();
+    sei();
+#endif
+    return false;
+};
+
+/* -------------------------------------------------------
+ * @brief Sleep until a timeout elapses or any interrupt wakes the CPU
+ * @param Timeout Longest sleep in milliseconds (0 = return at once)
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Idle(uint32_t Timeout)
+{
+    millis_Sleep(Timeout, NULL);
+};
+
+/* -------------------------------------------------------
+ * @brief Wait for a number of milliseconds in sleep
+ * @param Ms Milliseconds to wait
+ * @retval None
+ * @note Every wake-up (a tick or another interrupt) re-checks the time
+ *       and sleeps again for the rest
+ * ------------------------------------------------------- */
+void millis_Delay(uint32_t Ms)
+{
+    uint32_t _Start = millis();
+    uint32_t _Elapsed;
+
+    while ((_Elapsed = millis() - _Start) < Ms)
+    {
+        millis_Sleep(Ms - _Elapsed, NULL);
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief Wait in sleep until a condition is true or a timeout elapses
+ * @param Condition Function returning true when the wait is over
+ * @param Timeout   Longest wait in milliseconds
+ * @retval true if Condition became true, false on timeout
+ * @note Condition is checked on every wake-up, with interrupts disabled
+ *       right before each sleep, and once more at the timeout
+ * ------------------------------------------------------- */
+bool millis_WaitUntil(bool (*Condition)(void), uint32_t Timeout)
+{
+    uint32_t _Start = millis();
+    uint32_t _Elapsed;
 
-    /* ===== Set Compare Match Value for 1ms Interval ===== */
-    OCR0A = 249;                         /**< 250 ticks = 1ms at 250kHz timer frequency */
-                                         /**< OCR0A = 249 because counter resets when reaching this value (0-249 = 250 states) */
+    while ((_Elapsed = millis() - _Start) < Timeout)
+    {
+        if (millis_Sleep(Timeout - _Elapsed, Condition))
+        {
+            return true;
+        }
+    }
+    return Condition();                  /**< Last chance, an event in the final tick still counts */
 };
@@ -8,9 +8,85 @@
  * 
  * @note     This library provides Arduino-style millis() functionality for
  *           AVR microcontrollers using Timer0 in CTC mode with interrupt.
+ *           MILLIS_TIMER moves the tick to Timer1..5, which frees Timer0
+ *           for PWM. MILLIS_PWM keeps the timer in Fast PWM instead and
+ *           counts time from its overflow, as Arduino does.
+ *           With MILLIS_RTC the tick comes from Timer2 clocked by a
+ *           32.768kHz watch crystal and keeps running in power-save sleep.
+ *           On AVR-0/1 devices (ATmega4809, ATtiny1614, ...) the tick
+ *           runs on TCBn in periodic interrupt mode, or on the RTC
+ *           counter with MILLIS_RTC, picked at compile time from the
+ *           device header.
+ *
+ * @note     Configuration (compiler flags, defaults in brackets):
+ *           - F_CPU            : CPU clock in Hz (required unless MILLIS_RTC)
+ *           - MILLIS_TIMER     : Tick timer 0..5, 16-bit for 1/3/4/5 [0]
+ *           - MILLIS_PWM       : 1 = Fast PWM, time from the overflow [0]
+ *           - MILLIS_RTC       : 1 = 32.768kHz backend, Timer2 or the AVR-0/1 RTC [0]
+ *           - MILLIS_RTC_HZ    : Crystal frequency on TOSC1/TOSC2 [32768]
+ *           - MILLIS_TCB       : AVR-0/1 tick timer TCB0..3 [0]
+ *           - MILLIS_RTC_XTAL  : AVR-0/1 RTC clock, 1 = crystal, 0 = internal 32.768kHz [1]
+ *           - MILLIS_TICK_HZ   : Tick interrupt rate, must divide 1000 [1000]
+ *           - MILLIS_PRESCALER : Force a timer prescaler [auto]
+ *           - MILLIS_FRACTIONAL: 1 = drift-free non-integer periods [MILLIS_RTC or MILLIS_CALIBRATE]
+ *           - MILLIS_ISR_NAKED : 1 = hand-tuned 41-cycle tick ISR [0]
+ *           - MILLIS_TICKLESS  : 1 = millis_Idle skips ticks while asleep [0]
+ *           - MILLIS_TICKLESS_MAX: Ticks per sleep window, 2..255 [255]
+ *           - MILLIS_SLEEP_MODE: Sleep mode used by millis_Idle [SLEEP_MODE_IDLE]
+ *           - MILLIS8_SHIFT    : millis8_T unit is 2^n ms, 0..8 [3 = 8ms]
+ *           - MILLIS_UPTIME    : 1 = 64-bit uptime via a rollover epoch [0]
+ *           - MILLIS_DIVIDERS  : 1 = 10ms / 100ms / 1s counters and tick flags [0]
+ *           - MILLIS_ISR_TASKS : Callback slots run by the tick ISR, 0..16 [0]
+ *           - MILLIS_EVENTS    : ISR to main loop event ring, power of two [0]
+ *           - MILLIS_WATCHDOG  : Main-loop tasks with a deadline monitor, 0..16 [0]
+ *           - MILLIS_ISR_STATS : 1 = measure tick ISR load and entry latency [0]
+ *           - MILLIS_MISSED    : 1 = count late ticks [0]
+ *           - MILLIS_MISSED_LATENCY: Entry latency counted as late, in counts [half a period]
+ *           - MILLIS_CALIBRATE : 1 = trim the tick period against a reference at runtime [0]
+ *           - MILLIS_CAL_OSC_PPM: Error in ppm above which OSCCAL is stepped [4000]
+ *           - MILLIS_TICK_RATE : 1 = millis_SetTickRate switches the tick rate at runtime [0]
+ *           - MILLIS_HOST      : 1 = build for the host on a simulated Timer0 (millis_host.h) [0]
  *
  * @note     FUNCTION SUMMARY:
  *           - millis_Init : Initialize millisecond timer using SysTick interrupt
+ *           - millis      : Read a tear-free snapshot of System_millis (lock-free)
+ *           - micros      : Read microsecond timestamp from System_millis and the timer count
+ *           - millis_Stamp / millis_Stamp_Us : Raw timestamp capture and its conversion to us
+ *           - millis_Scheduler : Run all due tasks of a task table in one pass
+ *           - millis_Idle : Sleep until a timeout or any interrupt (tickless optional)
+ *           - millis_Delay : Blocking delay, sleeps instead of spinning
+ *           - millis_WaitUntil : Sleep until a condition is true, with a timeout
+ *           - millis_Elapsed : Time since Timer.Previous from one counter snapshot
+ *           - millis_Expired : Check a millis_T and re-arm it (fixed-delay or fixed-rate)
+ *           - millis_Rearm   : Start the next interval of a millis_T
+ *           - millis16    : Low 16 bits of the millisecond counter (for millis16_T)
+ *           - millis8     : Counter in 2^MILLIS8_SHIFT ms units, 8 bits (for millis8_T)
+ *           - millis16_Elapsed / millis8_Elapsed : Time since Previous, computed on demand
+ *           - millis16_Expired / millis8_Expired : Check and re-arm a compact timer
+ *           - millis64    : 64-bit millisecond uptime, ~8900 year range [MILLIS_UPTIME]
+ *           - millis_Uptime : Uptime in seconds plus milliseconds [MILLIS_UPTIME]
+ *           - millis_TickFlag : Test and clear a 10ms / 100ms / 1s flag [MILLIS_DIVIDERS]
+ *           - millis_Seconds  : Read the 16-bit seconds counter [MILLIS_DIVIDERS]
+ *           - millis_IsrTask_Start : Run a callback from the tick ISR every Period ms [MILLIS_ISR_TASKS]
+ *           - millis_IsrTask_Stop  : Release an ISR callback slot [MILLIS_ISR_TASKS]
+ *           - millis_Watchdog_Start / _Kick / _Stop : Per-task deadline monitor [MILLIS_WATCHDOG]
+ *           - millis_Watchdog_Report : Task and PC of the last deadline reset [MILLIS_WATCHDOG]
+ *           - millis_Watchdog_ResetFlags : MCUSR as it was at the reset [MILLIS_WATCHDOG]
+ *           - millis_IsrStats_Get   : Copy the tick ISR statistics [MILLIS_ISR_STATS]
+ *           - millis_IsrStats_Reset : Restart the tick ISR statistics [MILLIS_ISR_STATS]
+ *           - millis_IsrLoad        : CPU load of the tick ISR in 0.01% [MILLIS_ISR_STATS]
+ *           - millis_Missed         : Ticks served late since the last reset [MILLIS_MISSED]
+ *           - millis_Missed_Reset   : Clear the late tick counter [MILLIS_MISSED]
+ *           - millis_Catchup        : Add lost milliseconds, e.g. from an external reference
+ *           - millis_Calibrate      : Trim the tick period from a reference measurement [MILLIS_CALIBRATE]
+ *           - millis_Calibrate_Stamp: Stamp a reference edge, from its ISR [MILLIS_CALIBRATE]
+ *           - millis_Calibrate_Edge : Calibrate from the stamped edges, e.g. 1PPS [MILLIS_CALIBRATE]
+ *           - millis_Calibrate_Osc  : Step OSCCAL towards a reference [MILLIS_CALIBRATE]
+ *           - millis_Calibrate_Get / _Set : Read or restore the trimmed period [MILLIS_CALIBRATE]
+ *           - millis_SetTickRate    : Switch the tick rate, e.g. 10kHz / 1kHz / 100Hz [MILLIS_TICK_RATE]
+ *           - millis_TickRate       : Tick rate in effect [MILLIS_TICK_RATE]
+ *           - millis_Event_Post     : Queue a handler for the main loop, ISR side [MILLIS_EVENTS]
+ *           - millis_Event_Dispatch : Run the queued handlers, main loop side [MILLIS_EVENTS]
  * 
  * @note     Features:
  *           - Non-blocking interval timing using millis_T structure
@@ -21,16 +97,13 @@
  * @note     Usage:
  *           1. Call millis_Init() once during system initialization
  *           2. Create millis_T structure for each timing task
- *           3. Use System_millis to get current millisecond count
+ *           3. Use millis() to get current millisecond count
  *           4. Calculate elapsed time using delta between timestamps
  * 
  * @note     Example:
- *           extern volatile uint32_t System_millis;
  *           millis_T ledTimer = {.Delta = 0, .Previous = 0, .Interval = 1000};  // 1 second interval
- *           ledTimer.Delta = System_millis - ledTimer.Previous;
- *           if (ledTimer.Delta >= ledTimer.Interval) {
- *               ledTimer.Previous = currentMillis;
- *               // Execute periodic task
+ *           if (millis_Expired(&ledTimer, MILLIS_FIXED_RATE)) {
+ *               // Execute periodic task, no drift over time
  *           }
  * 
  * @note     For detailed documentation with examples, visit:
@@ -40,7 +113,15 @@
 #ifndef _millis_H_
 #define _millis_H_
 
-#include "aKaReZa.h"
+#ifndef MILLIS_HOST
+    #define MILLIS_HOST         0        /**< 1 = host (x86) build on a simulated Timer0, see millis_host.h */
+#endif
+
+#if MILLIS_HOST
+    #include "millis_host.h"
+#else
+    #include "aKaReZa.h"
+#endif
 
 
 /* ============================================================================
@@ -49,7 +130,7 @@
  *  This library requires the aKaReZa.h base library to compile correctly.
  *  If the file is missing, please download it or contact for support.
  * ============================================================================ */
-#ifndef _aKaReZa_H_
+#if !MILLIS_HOST && !defined(_aKaReZa_H_)
     #warning "============================================================"
     #warning " [WARNING] Missing required dependency: aKaReZa.h"
     #warning "------------------------------------------------------------"
@@ -62,6 +143,628 @@
 #endif
 
 
+/* ============================================================================
+ *                         TIMER CONFIGURATION
+ * ============================================================================
+ *  Prescaler and compare value are worked out at compile time from the
+ *  timer clock (F_CPU, or MILLIS_RTC_HZ with MILLIS_RTC) and
+ *  MILLIS_TICK_HZ, so there is no runtime math in millis_Init.
+ *  Override the defaults with compiler flags (e.g. -DMILLIS_TICK_HZ=500)
+ *  so every translation unit sees the same configuration.
+ * ============================================================================ */
+#ifndef MILLIS_RTC
+    #define MILLIS_RTC          0        /**< 1 = 32.768kHz backend: Timer2 asynchronous, or the RTC on AVR-0/1 */
+#endif
+
+/* ===== Device family (megaAVR-0 and tinyAVR-0/1 have TCA/TCB and an RTC peripheral) ===== */
+#if defined(__AVR_XMEGA__) && defined(TCB0)
+    #define MILLIS_AVR01        1        /**< Tick from TCBn in periodic interrupt mode, or from the RTC */
+#elif defined(__AVR_XMEGA__)
+    #error "The ATxmega timers (TCC0, TCD0, ...) are not supported - classic AVR and AVR-0/1 devices only"
+#else
+    #define MILLIS_AVR01        0        /**< Classic AVR, tick from Timer0..5 */
+#endif
+
+#if MILLIS_AVR01
+/* ===== Tick timer selection on AVR-0/1 (TCB instance digit, used to build register names) ===== */
+#ifdef MILLIS_TIMER
+    #error "MILLIS_TIMER selects a classic timer - use MILLIS_TCB on AVR-0/1 devices"
+#endif
+
+#ifndef MILLIS_TCB
+    #define MILLIS_TCB          0        /**< TCB driving the tick: 0..3, TCA stays free for PWM */
+#endif
+
+#ifndef MILLIS_RTC_XTAL
+    #define MILLIS_RTC_XTAL     1        /**< MILLIS_RTC clock: 1 = crystal on TOSC1/TOSC2, 0 = internal 32.768kHz oscillator */
+#endif
+#else
+/* ===== Tick timer selection (plain digit, used to build register names) ===== */
+#ifndef MILLIS_TIMER
+    #if MILLIS_RTC
+        #define MILLIS_TIMER    2        /**< The asynchronous backend always runs on Timer2 */
+    #else
+        #define MILLIS_TIMER    0        /**< Timer driving the tick: 0..5 */
+    #endif
+#endif
+
+#if MILLIS_RTC && (MILLIS_TIMER != 2)
+    #error "MILLIS_RTC runs on Timer2 only - remove MILLIS_TIMER or set it to 2"
+#endif
+#endif /* MILLIS_AVR01 */
+
+#ifndef MILLIS_PWM
+    #define MILLIS_PWM          0        /**< 1 = leave the timer in Fast PWM and count time from its overflow */
+#endif
+
+#if MILLIS_PWM && MILLIS_RTC
+    #error "MILLIS_PWM can not be combined with MILLIS_RTC"
+#endif
+
+#if MILLIS_PWM && MILLIS_AVR01
+    #error "MILLIS_PWM needs a classic Timer0/2 - on AVR-0/1 the tick runs on a TCB and TCA is left for PWM"
+#endif
+
+#if MILLIS_AVR01
+    #define MILLIS_TIMER_BITS   16       /**< TCB and RTC counters are 16 bits wide */
+    #define MILLIS_COUNTER_MAX  65535UL  /**< Highest value of the tick counter */
+#elif (MILLIS_TIMER == 0) || (MILLIS_TIMER == 2)
+    #define MILLIS_TIMER_BITS   8        /**< 8-bit timer, CTC mode 2 */
+    #define MILLIS_COUNTER_MAX  255UL    /**< Highest value of the tick counter */
+#elif (MILLIS_TIMER == 1) || (MILLIS_TIMER == 3) || (MILLIS_TIMER == 4) || (MILLIS_TIMER == 5)
+    #define MILLIS_TIMER_BITS   16       /**< 16-bit timer, CTC mode 4 (top = OCRnA) */
+    #define MILLIS_COUNTER_MAX  65535UL  /**< Highest value of the tick counter */
+#else
+    #error "MILLIS_TIMER must be 0, 1, 2, 3, 4 or 5"
+#endif
+
+#if MILLIS_PWM && (MILLIS_TIMER_BITS != 8)
+    #error "MILLIS_PWM needs an 8-bit timer (MILLIS_TIMER 0 or 2)"
+#endif
+
+/* -------------------------------------------------------
+ * @brief Build a register or bit name of the tick timer
+ * @note MILLIS_REG(OCR, A) expands to OCR0A, OCR1A, ... and
+ *       MILLIS_REG(TCNT, ) to TCNT0, TCNT1, ... The extra level of
+ *       indirection expands MILLIS_TIMER before pasting
+ * ------------------------------------------------------- */
+#define MILLIS_PASTE_(_A, _B, _C)   _A ## _B ## _C
+#define MILLIS_PASTE(_A, _B, _C)    MILLIS_PASTE_(_A, _B, _C)
+#define MILLIS_REG(_Pre, _Post)     MILLIS_PASTE(_Pre, MILLIS_TIMER, _Post)
+
+#if MILLIS_AVR01
+/* -------------------------------------------------------
+ * @brief Tick registers of the AVR-0/1 backends
+ * @note The same names as on the classic timers, so the rest of the
+ *       library is shared. The period register (CCMP, PER) resets the
+ *       counter like OCRnA in CTC mode, the counter runs 0..MILLIS_OCR.
+ *       Interrupt flags are not cleared on ISR entry, MILLIS_ISR_ACK
+ *       does it in the tick ISR
+ * ------------------------------------------------------- */
+#if MILLIS_RTC
+    #define MILLIS_TCNT         RTC.CNT                /**< Tick counter */
+    #define MILLIS_OCR          RTC.PER                /**< Period, the counter wraps after it */
+    #define MILLIS_TIMSK        RTC.INTCTRL            /**< Interrupt control register */
+    #define MILLIS_OCIE         RTC_OVF_bp             /**< Overflow interrupt enable bit */
+    #define MILLIS_TIFR         RTC.INTFLAGS           /**< Interrupt flag register */
+    #define MILLIS_OCF          RTC_OVF_bp             /**< Overflow flag, set when the counter passes PER */
+    #define MILLIS_COMPA_vect   RTC_CNT_vect
+#else
+    #define MILLIS_TCB_DEV      MILLIS_PASTE(TCB, MILLIS_TCB, )   /**< TCB0, TCB1, ... */
+    #define MILLIS_TCNT         MILLIS_TCB_DEV.CNT     /**< Tick counter */
+    #define MILLIS_OCR          MILLIS_TCB_DEV.CCMP    /**< Period in periodic interrupt mode */
+    #define MILLIS_TIMSK        MILLIS_TCB_DEV.INTCTRL /**< Interrupt control register */
+    #define MILLIS_OCIE         TCB_CAPT_bp            /**< Periodic interrupt enable bit */
+    #define MILLIS_TIFR         MILLIS_TCB_DEV.INTFLAGS    /**< Interrupt flag register */
+    #define MILLIS_OCF          TCB_CAPT_bp            /**< Set when the counter passes CCMP */
+    #define MILLIS_COMPA_vect   MILLIS_PASTE(TCB, MILLIS_TCB, _INT_vect)
+#endif
+#define MILLIS_ISR_ACK()        (MILLIS_TIFR = (1 << MILLIS_OCF))  /**< Flags are cleared by writing 1 */
+
+#if ((MILLIS_TCB == 1) && !defined(TCB1)) || ((MILLIS_TCB == 2) && !defined(TCB2)) || \
+    ((MILLIS_TCB == 3) && !defined(TCB3)) || (MILLIS_TCB < 0) || (MILLIS_TCB > 3)
+    #error "MILLIS_TCB selects a TCB this device does not have"
+#endif
+#else
+#define MILLIS_ISR_ACK()        ((void)0)              /**< The flag is cleared when the ISR is entered */
+
+#define MILLIS_TCCRA            MILLIS_REG(TCCR, A)    /**< Control register A (waveform mode) */
+#define MILLIS_TCCRB            MILLIS_REG(TCCR, B)    /**< Control register B (clock select) */
+#define MILLIS_TCNT             MILLIS_REG(TCNT, )     /**< Tick counter */
+#define MILLIS_OCR              MILLIS_REG(OCR, A)     /**< Tick compare value (top in CTC mode) */
+#define MILLIS_TIMSK            MILLIS_REG(TIMSK, )    /**< Interrupt mask register */
+#define MILLIS_OCIE             MILLIS_REG(OCIE, A)    /**< Compare match A interrupt enable bit */
+#define MILLIS_TIFR             MILLIS_REG(TIFR, )     /**< Interrupt flag register */
+#define MILLIS_OCF              MILLIS_REG(OCF, A)     /**< Compare match A flag */
+#define MILLIS_CS0              MILLIS_REG(CS, 0)      /**< Clock select bits CSn2:CSn0 */
+#define MILLIS_CS1              MILLIS_REG(CS, 1)
+#define MILLIS_CS2              MILLIS_REG(CS, 2)
+#define MILLIS_CS_MASK          ((1 << MILLIS_CS2) | (1 << MILLIS_CS1) | (1 << MILLIS_CS0))
+#define MILLIS_TOIE             MILLIS_REG(TOIE, )     /**< Overflow interrupt enable bit (MILLIS_PWM) */
+#define MILLIS_TOV              MILLIS_REG(TOV, )      /**< Overflow flag (MILLIS_PWM) */
+#define MILLIS_COMPA_vect       MILLIS_PASTE(TIMER, MILLIS_TIMER, _COMPA_vect)
+#define MILLIS_OVF_vect         MILLIS_PASTE(TIMER, MILLIS_TIMER, _OVF_vect)
+
+#if ((MILLIS_TIMER == 1) && !defined(TCCR1A)) || ((MILLIS_TIMER == 2) && !defined(TCCR2A)) || \
+    ((MILLIS_TIMER == 3) && !defined(TCCR3A)) || ((MILLIS_TIMER == 4) && !defined(TCCR4A)) || \
+    ((MILLIS_TIMER == 5) && !defined(TCCR5A))
+    #error "MILLIS_TIMER selects a timer this device does not have"
+#endif
+#endif /* MILLIS_AVR01 */
+
+/* ===== Waveform bits, split over TCCRnA and TCCRnB ===== */
+#if MILLIS_PWM
+    #define MILLIS_WGM_A_MASK   ((1 << MILLIS_REG(WGM, 1)) | (1 << MILLIS_REG(WGM, 0)))
+    #define MILLIS_WGM_A        MILLIS_WGM_A_MASK              /**< WGMn1:WGMn0 = 11, Fast PWM */
+    #define MILLIS_WGM_B_MASK   (1 << MILLIS_REG(WGM, 2))
+    #define MILLIS_WGM_B        0                              /**< WGMn2 = 0, TOP = 0xFF (mode 3) */
+#elif MILLIS_TIMER_BITS == 16
+    #define MILLIS_WGM_A_MASK   ((1 << MILLIS_REG(WGM, 1)) | (1 << MILLIS_REG(WGM, 0)))
+    #define MILLIS_WGM_A        0                              /**< WGMn1:WGMn0 = 00 */
+    #define MILLIS_WGM_B_MASK   ((1 << MILLIS_REG(WGM, 3)) | (1 << MILLIS_REG(WGM, 2)))
+    #define MILLIS_WGM_B        (1 << MILLIS_REG(WGM, 2))      /**< WGMn3:WGMn2 = 01 */
+#else
+    #define MILLIS_WGM_A_MASK   ((1 << MILLIS_REG(WGM, 1)) | (1 << MILLIS_REG(WGM, 0)))
+    #define MILLIS_WGM_A        (1 << MILLIS_REG(WGM, 1))      /**< WGMn1:WGMn0 = 10 */
+    #define MILLIS_WGM_B_MASK   (1 << MILLIS_REG(WGM, 2))
+    #define MILLIS_WGM_B        0                              /**< WGMn2 = 0 */
+#endif
+
+#if MILLIS_RTC
+    #ifndef MILLIS_RTC_HZ
+        #define MILLIS_RTC_HZ   32768UL  /**< Watch crystal frequency on TOSC1/TOSC2 */
+    #endif
+    #define MILLIS_TIMER_HZ     (MILLIS_RTC_HZ)  /**< Timer input clock before the prescaler */
+#else
+    #ifndef F_CPU
+        #error "F_CPU is not defined - the millis timer configuration is derived from it"
+    #endif
+    #define MILLIS_TIMER_HZ     (F_CPU)  /**< Timer input clock before the prescaler */
+#endif
+
+#ifndef MILLIS_TICK_HZ
+    #define MILLIS_TICK_HZ      1000UL   /**< Tick interrupt rate in Hz, must divide 1000 */
+#endif
+
+#if ((MILLIS_TICK_HZ) == 0) || ((1000UL % (MILLIS_TICK_HZ)) != 0)
+    #error "MILLIS_TICK_HZ must divide 1000 so System_millis advances in whole milliseconds"
+#endif
+
+#define MILLIS_MS_PER_TICK      (1000UL / (MILLIS_TICK_HZ))  /**< Milliseconds added per tick interrupt */
+
+/* ===== Runtime trim of the tick period (see millis_Calibrate) ===== */
+#ifndef MILLIS_CALIBRATE
+    #define MILLIS_CALIBRATE    0        /**< 1 = tick period is a runtime value trimmed against a reference */
+#endif
+
+/* ===== Tick rate switchable at runtime (see millis_SetTickRate) ===== */
+#ifndef MILLIS_TICK_RATE
+    #define MILLIS_TICK_RATE    0        /**< 1 = prescaler and period are runtime values, MILLIS_TICK_HZ is the start rate */
+#endif
+
+#define MILLIS_RUNTIME_PERIOD   (MILLIS_CALIBRATE || MILLIS_TICK_RATE)  /**< ISR loads the period from RAM */
+
+#ifndef MILLIS_FRACTIONAL
+    #define MILLIS_FRACTIONAL   (MILLIS_RTC || MILLIS_CALIBRATE)  /**< 1 = allow non-integer periods with drift correction */
+#endif
+
+/* -------------------------------------------------------
+ * @brief Check if a prescaler reaches the tick period exactly
+ * @note True when the period is a whole number of counts that fits
+ *       the counter (at most 256 counts, 65536 on 16-bit timers)
+ * ------------------------------------------------------- */
+#define MILLIS_EXACT(_Presc)    ((((MILLIS_TIMER_HZ) % ((_Presc) * (MILLIS_TICK_HZ))) == 0) && \
+                                 (((MILLIS_TIMER_HZ) / ((_Presc) * (MILLIS_TICK_HZ))) <= (MILLIS_COUNTER_MAX + 1UL)))
+
+/* -------------------------------------------------------
+ * @brief Check if a prescaler can reach the tick period on average
+ * @note True when the next whole count above the period still fits the
+ *       counter, so short and long periods can be mixed
+ * ------------------------------------------------------- */
+#define MILLIS_FITS(_Presc)     ((((MILLIS_TIMER_HZ) + ((_Presc) * (MILLIS_TICK_HZ)) - 1) / \
+                                  ((_Presc) * (MILLIS_TICK_HZ))) <= (MILLIS_COUNTER_MAX + 1UL))
+
+/* -------------------------------------------------------
+ * @brief Check if a prescaler leaves room to trim the period
+ * @note True when a period 1/8 longer than nominal stays below the
+ *       full counter range, which also keeps it within 16.16 fixed
+ *       point. millis_Calibrate can then follow an oscillator that is
+ *       up to 12.5% fast. At 16MHz this picks /256 for Timer0 (62.5
+ *       counts per ms) and /1 for Timer1
+ * ------------------------------------------------------- */
+#define MILLIS_FITS_TRIM(_Presc) ((((MILLIS_TIMER_HZ) * 9UL + (8UL * (_Presc) * (MILLIS_TICK_HZ)) - 1) / \
+                                  (8UL * (_Presc) * (MILLIS_TICK_HZ))) <= (MILLIS_COUNTER_MAX))
+
+#if MILLIS_CALIBRATE
+    #define MILLIS_USABLE(_Presc)   MILLIS_FITS_TRIM(_Presc)
+#elif MILLIS_FRACTIONAL
+    #define MILLIS_USABLE(_Presc)   MILLIS_FITS(_Presc)
+#else
+    #define MILLIS_USABLE(_Presc)   MILLIS_EXACT(_Presc)
+#endif
+
+/* ===== Fast-PWM mode keeps the Arduino default (976Hz PWM at 16MHz) ===== */
+#if MILLIS_PWM && !defined(MILLIS_PRESCALER)
+    #define MILLIS_PRESCALER    64UL
+#endif
+
+/* ===== TCB only divides CLK_PER by 1 or 2 (the TCA clock is left to the application) ===== */
+#if MILLIS_AVR01 && !MILLIS_RTC && !defined(MILLIS_PRESCALER)
+    #if   MILLIS_USABLE(1UL)
+        #define MILLIS_PRESCALER    1UL
+    #elif MILLIS_USABLE(2UL)
+        #define MILLIS_PRESCALER    2UL
+    #else
+        #error "The MILLIS_TICK_HZ period does not fit TCB at this F_CPU (65536 counts at /2) - raise MILLIS_TICK_HZ"
+    #endif
+#endif
+
+/* ===== Select the smallest prescaler (best micros resolution) ===== */
+#ifndef MILLIS_PRESCALER
+    #if   MILLIS_USABLE(1UL)
+        #define MILLIS_PRESCALER    1UL
+    #elif MILLIS_USABLE(8UL)
+        #define MILLIS_PRESCALER    8UL
+    #elif ((MILLIS_TIMER == 2) || MILLIS_AVR01) && MILLIS_USABLE(32UL)
+        #define MILLIS_PRESCALER    32UL
+    #elif MILLIS_USABLE(64UL)
+        #define MILLIS_PRESCALER    64UL
+    #elif ((MILLIS_TIMER == 2) || MILLIS_AVR01) && MILLIS_USABLE(128UL)
+        #define MILLIS_PRESCALER    128UL
+    #elif MILLIS_USABLE(256UL)
+        #define MILLIS_PRESCALER    256UL
+    #elif MILLIS_USABLE(1024UL)
+        #define MILLIS_PRESCALER    1024UL
+    #elif MILLIS_FRACTIONAL
+        #error "No timer prescaler fits the MILLIS_TICK_HZ period at this timer clock"
+    #else
+        #error "No timer prescaler reaches the exact MILLIS_TICK_HZ period at this F_CPU - define MILLIS_FRACTIONAL=1"
+    #endif
+#elif !MILLIS_PWM && !MILLIS_USABLE(MILLIS_PRESCALER)
+    #error "MILLIS_PRESCALER does not reach the MILLIS_TICK_HZ period at this timer clock"
+#endif
+
+#if MILLIS_AVR01 && MILLIS_RTC
+/* ===== RTC.CTRLA prescaler field, the RTC divides by any power of two up to 32768 ===== */
+#if   (MILLIS_PRESCALER) == 1
+    #define MILLIS_CLOCK_SELECT (0 << RTC_PRESCALER_gp)
+#elif (MILLIS_PRESCALER) == 8
+    #define MILLIS_CLOCK_SELECT (3 << RTC_PRESCALER_gp)
+#elif (MILLIS_PRESCALER) == 32
+    #define MILLIS_CLOCK_SELECT (5 << RTC_PRESCALER_gp)
+#elif (MILLIS_PRESCALER) == 64
+    #define MILLIS_CLOCK_SELECT (6 << RTC_PRESCALER_gp)
+#elif (MILLIS_PRESCALER) == 128
+    #define MILLIS_CLOCK_SELECT (7 << RTC_PRESCALER_gp)
+#elif (MILLIS_PRESCALER) == 256
+    #define MILLIS_CLOCK_SELECT (8 << RTC_PRESCALER_gp)
+#elif (MILLIS_PRESCALER) == 1024
+    #define MILLIS_CLOCK_SELECT (10 << RTC_PRESCALER_gp)
+#else
+    #error "MILLIS_PRESCALER must be 1, 8, 32, 64, 128, 256 or 1024 for the RTC"
+#endif
+#elif MILLIS_AVR01
+/* ===== TCBn.CTRLA clock select field (CLK_PER / 1 or / 2) ===== */
+#if   (MILLIS_PRESCALER) == 1
+    #define MILLIS_CLOCK_SELECT (0 << TCB_CLKSEL_gp)
+#elif (MILLIS_PRESCALER) == 2
+    #define MILLIS_CLOCK_SELECT (1 << TCB_CLKSEL_gp)
+#else
+    #error "MILLIS_PRESCALER must be 1 or 2 for TCB"
+#endif
+#elif MILLIS_TIMER == 2
+/* ===== Clock select bits CS22:CS20 for the chosen prescaler (Timer2) ===== */
+#if   (MILLIS_PRESCALER) == 1
+    #define MILLIS_CLOCK_SELECT ((0 << MILLIS_CS2) | (0 << MILLIS_CS1) | (1 << MILLIS_CS0))
+#elif (MILLIS_PRESCALER) == 8
+    #define MILLIS_CLOCK_SELECT ((0 << MILLIS_CS2) | (1 << MILLIS_CS1) | (0 << MILLIS_CS0))
+#elif (MILLIS_PRESCALER) == 32
+    #define MILLIS_CLOCK_SELECT ((0 << MILLIS_CS2) | (1 << MILLIS_CS1) | (1 << MILLIS_CS0))
+#elif (MILLIS_PRESCALER) == 64
+    #define MILLIS_CLOCK_SELECT ((1 << MILLIS_CS2) | (0 << MILLIS_CS1) | (0 << MILLIS_CS0))
+#elif (MILLIS_PRESCALER) == 128
+    #define MILLIS_CLOCK_SELECT ((1 << MILLIS_CS2) | (0 << MILLIS_CS1) | (1 << MILLIS_CS0))
+#elif (MILLIS_PRESCALER) == 256
+    #define MILLIS_CLOCK_SELECT ((1 << MILLIS_CS2) | (1 << MILLIS_CS1) | (0 << MILLIS_CS0))
+#elif (MILLIS_PRESCALER) == 1024
+    #define MILLIS_CLOCK_SELECT ((1 << MILLIS_CS2) | (1 << MILLIS_CS1) | (1 << MILLIS_CS0))
+#else
+    #error "MILLIS_PRESCALER must be 1, 8, 32, 64, 128, 256 or 1024 for Timer2"
+#endif
+#else
+/* ===== Clock select bits CSn2:CSn0 for the chosen prescaler (Timer0/1/3/4/5) ===== */
+#if   (MILLIS_PRESCALER) == 1
+    #define MILLIS_CLOCK_SELECT ((0 << MILLIS_CS2) | (0 << MILLIS_CS1) | (1 << MILLIS_CS0))
+#elif (MILLIS_PRESCALER) == 8
+    #define MILLIS_CLOCK_SELECT ((0 << MILLIS_CS2) | (1 << MILLIS_CS1) | (0 << MILLIS_CS0))
+#elif (MILLIS_PRESCALER) == 64
+    #define MILLIS_CLOCK_SELECT ((0 << MILLIS_CS2) | (1 << MILLIS_CS1) | (1 << MILLIS_CS0))
+#elif (MILLIS_PRESCALER) == 256
+    #define MILLIS_CLOCK_SELECT ((1 << MILLIS_CS2) | (0 << MILLIS_CS1) | (0 << MILLIS_CS0))
+#elif (MILLIS_PRESCALER) == 1024
+    #define MILLIS_CLOCK_SELECT ((1 << MILLIS_CS2) | (0 << MILLIS_CS1) | (1 << MILLIS_CS0))
+#else
+    #error "MILLIS_PRESCALER must be 1, 8, 64, 256 or 1024 for this timer"
+#endif
+#endif /* MILLIS_AVR01, MILLIS_TIMER == 2 */
+
+#define MILLIS_TIMER_COUNTS     ((MILLIS_TIMER_HZ) / ((MILLIS_PRESCALER) * (MILLIS_TICK_HZ)))  /**< Whole timer counts per tick */
+#define MILLIS_COMPARE          (MILLIS_TIMER_COUNTS - 1)    /**< Compare value, counter runs 0..MILLIS_COMPARE */
+
+/* -------------------------------------------------------
+ * @brief Fractional part of the tick period (Bresenham accumulator)
+ * @note  Counts per tick = MILLIS_TIMER_COUNTS + MILLIS_FRACT_REM / MILLIS_FRACT_DEN
+ *        The fraction is reduced by its common power of two, which is
+ *        the lowest set bit of (remainder | denominator)
+ * ------------------------------------------------------- */
+#if MILLIS_PWM
+/* -------------------------------------------------------
+ * @brief Milliseconds per overflow in Fast-PWM mode
+ * @note  One overflow takes 256 * MILLIS_PRESCALER timer clocks, which is
+ *        MILLIS_PWM_MS + MILLIS_FRACT_REM / MILLIS_FRACT_DEN milliseconds.
+ *        The same accumulator carries the fraction, but here it adds a
+ *        millisecond instead of a count, e.g. 16MHz / 64: 1 + 3/125 ms
+ * ------------------------------------------------------- */
+#define MILLIS_PWM_CLOCKS       (256UL * (MILLIS_PRESCALER))                         /**< Timer clocks per overflow */
+#define MILLIS_PWM_MS           ((MILLIS_PWM_CLOCKS * 1000UL) / (MILLIS_TIMER_HZ))   /**< Whole ms per overflow */
+#define MILLIS_FRACT_REM_RAW    ((MILLIS_PWM_CLOCKS * 1000UL) % (MILLIS_TIMER_HZ))
+#define MILLIS_FRACT_DEN_RAW    (MILLIS_TIMER_HZ)
+#else
+#define MILLIS_FRACT_REM_RAW    ((MILLIS_TIMER_HZ) % ((MILLIS_PRESCALER) * (MILLIS_TICK_HZ)))
+#define MILLIS_FRACT_DEN_RAW    ((MILLIS_PRESCALER) * (MILLIS_TICK_HZ))
+#endif
+#define MILLIS_FRACT_GCD2       ((MILLIS_FRACT_REM_RAW | MILLIS_FRACT_DEN_RAW) & \
+                                 (~(MILLIS_FRACT_REM_RAW | MILLIS_FRACT_DEN_RAW) + 1))
+#define MILLIS_FRACT_REM        (MILLIS_FRACT_REM_RAW / MILLIS_FRACT_GCD2)
+#define MILLIS_FRACT_DEN        (MILLIS_FRACT_DEN_RAW / MILLIS_FRACT_GCD2)
+
+#if MILLIS_FRACTIONAL && !MILLIS_PWM && !MILLIS_RUNTIME_PERIOD && (MILLIS_FRACT_REM_RAW != 0)
+    #define MILLIS_FRACT_ACTIVE 1        /**< Period alternates between MILLIS_COMPARE and MILLIS_COMPARE + 1 */
+#else
+    #define MILLIS_FRACT_ACTIVE 0        /**< Period is exact, no accumulator needed */
+#endif
+
+#if MILLIS_PWM && (MILLIS_FRACT_REM_RAW != 0)
+    #define MILLIS_PWM_FRACT    1        /**< Overflow adds MILLIS_PWM_MS or MILLIS_PWM_MS + 1 */
+    #define MILLIS_FRACT_US     ((1000UL << 22) / (MILLIS_FRACT_DEN))   /**< Microseconds per accumulator unit, 10.22 fixed point */
+#else
+    #define MILLIS_PWM_FRACT    0        /**< Overflow is a whole number of milliseconds */
+#endif
+
+/* -------------------------------------------------------
+ * @brief Fraction bits of the micros() scale
+ * @note 8 bits leave a count of 0.05us (TCB at 20MHz / 1) as 12/256
+ *       instead of 12.8/256, 6% short. Counts of 0.5us and less get 16
+ *       bits, a full 16-bit count times the scale still fits 32 bits
+ *       with 12.5% trim headroom. The runtime tick rate keeps 8, its
+ *       scale follows the prescaler
+ * ------------------------------------------------------- */
+#if !MILLIS_TICK_RATE && ((2ULL * (MILLIS_PRESCALER) * 1000000ULL) <= (MILLIS_TIMER_HZ))
+    #define MILLIS_US_SHIFT     16       /**< Scale in 16.16 fixed point */
+#else
+    #define MILLIS_US_SHIFT     8        /**< Scale in 24.8 fixed point */
+#endif
+
+/* ===== Microseconds per timer count in fixed point with MILLIS_US_SHIFT fraction bits (used by micros) ===== */
+#define MILLIS_US_SCALE         ((uint32_t)((((uint64_t)(MILLIS_PRESCALER) * 1000000ULL) << MILLIS_US_SHIFT) / (MILLIS_TIMER_HZ)))
+
+/* ===== 1 = a full counter range times MILLIS_US_SCALE overflows 32 bits (slow 16-bit timers) ===== */
+#define MILLIS_US_WIDE          ((((MILLIS_COUNTER_MAX + 1ULL) * (MILLIS_PRESCALER) * (1000000ULL << MILLIS_US_SHIFT)) / \
+                                  (MILLIS_TIMER_HZ)) > 0xFFFFFFFFULL)
+
+#if MILLIS_RTC && MILLIS_FRACT_ACTIVE && (MILLIS_TIMER_COUNTS < 8)
+    #error "MILLIS_RTC needs at least 8 counts per tick, period updates take 2-3 crystal cycles to apply"
+#endif
+
+/* ===== Hand-tuned tick ISR (saves only the registers it touches) ===== */
+#ifndef MILLIS_ISR_NAKED
+    #define MILLIS_ISR_NAKED    0        /**< 1 = ISR_NAKED assembly tick handler */
+#endif
+
+#if MILLIS_ISR_NAKED && MILLIS_PWM
+    #error "MILLIS_ISR_NAKED needs CTC mode - disable MILLIS_PWM"
+#endif
+
+#if MILLIS_ISR_NAKED && MILLIS_FRACT_ACTIVE
+    #error "MILLIS_ISR_NAKED only supports exact periods - disable MILLIS_FRACTIONAL or pick an exact F_CPU"
+#endif
+
+#if MILLIS_ISR_NAKED && (MILLIS_MS_PER_TICK > 255)
+    #error "MILLIS_ISR_NAKED needs MILLIS_MS_PER_TICK below 256"
+#endif
+
+/* ===== Tickless idle (skip ticks while sleeping in millis_Idle) ===== */
+#ifndef MILLIS_TICKLESS
+    #define MILLIS_TICKLESS     0        /**< 1 = millis_Idle stretches the timer period to the deadline */
+#endif
+
+#ifndef MILLIS_TICKLESS_MAX
+    #define MILLIS_TICKLESS_MAX 255      /**< Upper limit of ticks covered by one sleep window (2..255) */
+#endif
+
+#ifndef MILLIS_SLEEP_MODE
+    #if MILLIS_RTC && MILLIS_AVR01
+        #define MILLIS_SLEEP_MODE   SLEEP_MODE_STANDBY   /**< Sleep mode of millis_Idle, the RTC runs in standby */
+    #elif MILLIS_RTC
+        #define MILLIS_SLEEP_MODE   SLEEP_MODE_PWR_SAVE  /**< Sleep mode of millis_Idle, Timer2 keeps running */
+    #else
+        #define MILLIS_SLEEP_MODE   SLEEP_MODE_IDLE      /**< Sleep mode of millis_Idle, synchronous timers need clk_IO */
+    #endif
+#endif
+
+#if MILLIS_TICKLESS && MILLIS_ISR_NAKED
+    #error "MILLIS_TICKLESS needs the C tick ISR - disable MILLIS_ISR_NAKED"
+#endif
+
+#if MILLIS_TICKLESS && MILLIS_PWM
+    #error "MILLIS_TICKLESS needs CTC mode - the Fast-PWM period is fixed"
+#endif
+
+#if MILLIS_TICKLESS && MILLIS_RTC
+    #error "MILLIS_TICKLESS is not supported with MILLIS_RTC - lower MILLIS_TICK_HZ to cut wake-ups instead"
+#endif
+
+#if MILLIS_TICKLESS && ((MILLIS_TICKLESS_MAX < 2) || (MILLIS_TICKLESS_MAX > 255))
+    #error "MILLIS_TICKLESS_MAX must be between 2 and 255"
+#endif
+
+/* ===== Callbacks dispatched from the tick ISR ===== */
+#ifndef MILLIS_ISR_TASKS
+    #define MILLIS_ISR_TASKS    0        /**< Number of ISR callback slots, 0 = feature compiled out */
+#endif
+
+#if (MILLIS_ISR_TASKS < 0) || (MILLIS_ISR_TASKS > 16)
+    #error "MILLIS_ISR_TASKS must be between 0 and 16"
+#endif
+
+#if MILLIS_ISR_TASKS && MILLIS_ISR_NAKED
+    #error "MILLIS_ISR_TASKS needs the C tick ISR - disable MILLIS_ISR_NAKED"
+#endif
+
+#if MILLIS_ISR_TASKS && MILLIS_PWM
+    #error "MILLIS_ISR_TASKS needs CTC mode - the Fast-PWM overflow is not a whole tick"
+#endif
+
+/* ===== Deadline monitor for main-loop tasks ===== */
+#ifndef MILLIS_WATCHDOG
+    #define MILLIS_WATCHDOG     0        /**< Number of monitored tasks, 0 = feature compiled out */
+#endif
+
+#if (MILLIS_WATCHDOG < 0) || (MILLIS_WATCHDOG > 16)
+    #error "MILLIS_WATCHDOG must be between 0 and 16"
+#endif
+
+#if MILLIS_WATCHDOG && MILLIS_ISR_NAKED
+    #error "MILLIS_WATCHDOG needs the C tick ISR - disable MILLIS_ISR_NAKED"
+#endif
+
+#if MILLIS_WATCHDOG && MILLIS_PWM
+    #error "MILLIS_WATCHDOG needs CTC mode - the Fast-PWM overflow is not a whole tick"
+#endif
+
+#define MILLIS_WDG_MAGIC        0xD06AU  /**< Marks a valid millis_WdgReport_T in .noinit */
+
+/* ===== Tick ISR load and latency statistics ===== */
+#ifndef MILLIS_ISR_STATS
+    #define MILLIS_ISR_STATS    0        /**< 1 = record busy time and entry latency of the tick ISR */
+#endif
+
+#if MILLIS_ISR_STATS && MILLIS_ISR_NAKED
+    #error "MILLIS_ISR_STATS needs the C tick ISR - disable MILLIS_ISR_NAKED"
+#endif
+
+#if MILLIS_PWM
+    #define MILLIS_PERIOD_COUNTS    256UL    /**< Timer counts between two tick interrupts (one overflow) */
+#else
+    #define MILLIS_PERIOD_COUNTS    MILLIS_TIMER_COUNTS  /**< Timer counts between two tick interrupts */
+#endif
+
+/* ===== Late tick detection ===== */
+#ifndef MILLIS_MISSED
+    #define MILLIS_MISSED       0        /**< 1 = count ticks served too late (missed-tick warning) */
+#endif
+
+#ifndef MILLIS_MISSED_LATENCY
+    #define MILLIS_MISSED_LATENCY   (MILLIS_PERIOD_COUNTS / 2)   /**< Entry latency in counts that counts as late */
+#endif
+
+#if MILLIS_MISSED && MILLIS_ISR_NAKED
+    #error "MILLIS_MISSED needs the C tick ISR - disable MILLIS_ISR_NAKED"
+#endif
+
+#if MILLIS_MISSED && ((MILLIS_MISSED_LATENCY < 1) || (MILLIS_MISSED_LATENCY > MILLIS_COUNTER_MAX))
+    #error "MILLIS_MISSED_LATENCY must be between 1 and the highest timer count"
+#endif
+
+/* ===== Runtime calibration checks ===== */
+#ifndef MILLIS_CAL_OSC_PPM
+    #define MILLIS_CAL_OSC_PPM  4000L    /**< millis_Calibrate_Osc steps OSCCAL above this error (one step is ~0.5..1%) */
+#endif
+
+#if MILLIS_CALIBRATE && !MILLIS_FRACTIONAL
+    #error "MILLIS_CALIBRATE needs MILLIS_FRACTIONAL - a trimmed period is rarely a whole number of counts"
+#endif
+
+#if MILLIS_CALIBRATE && MILLIS_PWM
+    #error "MILLIS_CALIBRATE needs CTC mode - the Fast-PWM period is fixed"
+#endif
+
+#if MILLIS_CALIBRATE && MILLIS_ISR_NAKED
+    #error "MILLIS_CALIBRATE needs the C tick ISR - disable MILLIS_ISR_NAKED"
+#endif
+
+#if MILLIS_CALIBRATE && MILLIS_TICKLESS
+    #error "MILLIS_CALIBRATE can not be combined with MILLIS_TICKLESS - sleep windows use the nominal period"
+#endif
+
+/* ===== Runtime tick rate checks ===== */
+#if MILLIS_TICK_RATE && (MILLIS_PWM || MILLIS_RTC || MILLIS_ISR_NAKED || MILLIS_TICKLESS)
+    #error "MILLIS_TICK_RATE needs the C tick ISR in CTC mode on a synchronous timer - disable MILLIS_PWM, MILLIS_RTC, MILLIS_ISR_NAKED and MILLIS_TICKLESS"
+#endif
+
+#if MILLIS_TICK_RATE && (MILLIS_CALIBRATE || MILLIS_ISR_TASKS || MILLIS_WATCHDOG || MILLIS_ISR_STATS || MILLIS_MISSED)
+    #error "MILLIS_TICK_RATE can not be combined with MILLIS_CALIBRATE, MILLIS_ISR_TASKS, MILLIS_WATCHDOG, MILLIS_ISR_STATS or MILLIS_MISSED - they assume a fixed tick"
+#endif
+
+/* ===== AVR-0/1 backend checks ===== */
+#if MILLIS_AVR01 && MILLIS_ISR_NAKED
+    #error "MILLIS_ISR_NAKED can not be used on AVR-0/1 - the assembly tick ISR does not clear the interrupt flag"
+#endif
+
+#if MILLIS_AVR01 && MILLIS_TICK_RATE
+    #error "MILLIS_TICK_RATE switches classic prescalers - it is not available on AVR-0/1"
+#endif
+
+/* ===== Host build checks ===== */
+#if MILLIS_HOST && ((MILLIS_TIMER != 0) || MILLIS_PWM || MILLIS_RTC || MILLIS_ISR_NAKED || MILLIS_WATCHDOG)
+    #error "MILLIS_HOST simulates Timer0 in CTC mode only - disable MILLIS_TIMER, MILLIS_PWM, MILLIS_RTC, MILLIS_ISR_NAKED and MILLIS_WATCHDOG"
+#endif
+
+#define MILLIS_CAL_NO_EDGE      INT32_MIN    /**< Returned by millis_Calibrate_Edge without a new edge */
+
+/* ===== Nominal period in 16.16 fixed point counts, start value of the trim ===== */
+#define MILLIS_CAL_NOMINAL      (((uint32_t)(MILLIS_TIMER_COUNTS) << 16) + \
+                                 (uint32_t)(((uint64_t)(MILLIS_FRACT_REM_RAW) << 16) / (MILLIS_FRACT_DEN_RAW)))
+
+/* ===== Deferred work from ISRs to the main loop ===== */
+#ifndef MILLIS_EVENTS
+    #define MILLIS_EVENTS       0        /**< Slots of the ISR to main loop event ring, 0 = compiled out */
+#endif
+
+#if MILLIS_EVENTS && ((MILLIS_EVENTS > 128) || (MILLIS_EVENTS & (MILLIS_EVENTS - 1)))
+    #error "MILLIS_EVENTS must be 0 or a power of two up to 128"
+#endif
+
+/* ===== Compact 8-bit timers (millis8_T) ===== */
+#ifndef MILLIS8_SHIFT
+    #define MILLIS8_SHIFT       3        /**< millis8_T unit is 2^MILLIS8_SHIFT ms (3 = 8ms, range 2.04s) */
+#endif
+
+#if (MILLIS8_SHIFT < 0) || (MILLIS8_SHIFT > 8)
+    #error "MILLIS8_SHIFT must be between 0 and 8"
+#endif
+
+/* ===== Extended uptime (epoch counter above the 32-bit System_millis) ===== */
+#ifndef MILLIS_UPTIME
+    #define MILLIS_UPTIME       0        /**< 1 = count System_millis rollovers for millis64/millis_Uptime */
+#endif
+
+/* ===== Coarse counters and tick flags (10ms / 100ms / 1s) ===== */
+#ifndef MILLIS_DIVIDERS
+    #define MILLIS_DIVIDERS     0        /**< 1 = the tick ISR keeps 10ms, 100ms and 1s counters and flags */
+#endif
+
+#if MILLIS_DIVIDERS && MILLIS_ISR_NAKED
+    #error "MILLIS_DIVIDERS needs the C tick ISR - disable MILLIS_ISR_NAKED"
+#endif
+
+/* ===== Flags in System_tickFlags, test them with millis_TickFlag ===== */
+#define MILLIS_FLAG_10MS        0x01     /**< Set every 10ms */
+#define MILLIS_FLAG_100MS       0x02     /**< Set every 100ms */
+#define MILLIS_FLAG_1S          0x04     /**< Set every second */
+
+
+
 /* ============================================================================
  *                         TYPE DEFINITIONS
  * ============================================================================ */
@@ -77,6 +780,148 @@ typedef struct
     uint32_t Interval;    /**< Desired interval duration in milliseconds for periodic events */
 } millis_T;
 
+/* -------------------------------------------------------
+ * @brief Re-arm modes of millis_Rearm / millis_Expired
+ * ------------------------------------------------------- */
+#define MILLIS_FIXED_DELAY      0        /**< Next interval starts when the expiry is seen (Previous = now) */
+#define MILLIS_FIXED_RATE       1        /**< Next interval starts at the old deadline (Previous += Interval) */
+
+/* -------------------------------------------------------
+ * @brief Compact 16-bit interval timer (4 bytes instead of 12)
+ * @note Compares on the low 16 bits of the counter, so intervals up to
+ *       65535 ms are wrap-safe. Must be checked at least once every
+ *       65.5 s, or an expiry can be missed by a whole wrap
+ * @note There is no Delta member, millis16_Elapsed computes it
+ * ------------------------------------------------------- */
+typedef struct
+{
+    uint16_t Previous;    /**< Low 16 bits of the last event time */
+    uint16_t Interval;    /**< Interval in milliseconds, 1..65535 */
+} millis16_T;
+
+/* -------------------------------------------------------
+ * @brief Compact 8-bit interval timer (2 bytes)
+ * @note Counts in units of 2^MILLIS8_SHIFT ms (8ms by default), so the
+ *       longest interval is 255 units (2.04 s). A power of two unit
+ *       keeps the 8-bit counter continuous when System_millis wraps
+ * @note Must be checked at least once every 256 units
+ * ------------------------------------------------------- */
+typedef struct
+{
+    uint8_t  Previous;    /**< millis8() at the last event */
+    uint8_t  Interval;    /**< Interval in 2^MILLIS8_SHIFT ms units, 1..255 */
+} millis8_T;
+
+/* -------------------------------------------------------
+ * @brief Convert milliseconds to millis8_T units at compile time
+ * @note Rounds to the nearest unit, e.g. MILLIS8_MS(100) = 13 (104 ms)
+ * ------------------------------------------------------- */
+#define MILLIS8_MS(_Ms)         ((uint8_t)(((_Ms) + (1UL << MILLIS8_SHIFT >> 1)) >> MILLIS8_SHIFT))
+
+/* -------------------------------------------------------
+ * @brief Raw count of the tick timer
+ * @note 8 bits for Timer0/2, 16 bits for Timer1/3/4/5
+ * ------------------------------------------------------- */
+#if MILLIS_TIMER_BITS == 16
+typedef uint16_t millis_Count_T;
+#else
+typedef uint8_t  millis_Count_T;
+#endif
+
+/* -------------------------------------------------------
+ * @brief Milliseconds added to System_millis in one step
+ * @note A tickless sleep window adds up to MILLIS_TICKLESS_MAX ticks at
+ *       once, with a slow tick this no longer fits 16 bits
+ * ------------------------------------------------------- */
+#if MILLIS_TICKLESS && ((MILLIS_TICKLESS_MAX * MILLIS_MS_PER_TICK) > 0xFFFFUL)
+typedef uint32_t millis_Step_T;
+#else
+typedef uint16_t millis_Step_T;
+#endif
+
+/* -------------------------------------------------------
+ * @brief Bresenham accumulator of the drift correction
+ * @note Holds up to twice the reduced denominator
+ * ------------------------------------------------------- */
+#if MILLIS_FRACT_ACTIVE || MILLIS_PWM_FRACT
+    #if MILLIS_FRACT_DEN <= 0x8000
+typedef uint16_t millis_Fract_T;
+    #else
+typedef uint32_t millis_Fract_T;
+    #endif
+#endif
+
+/* -------------------------------------------------------
+ * @brief Raw timestamp taken by millis_Stamp
+ * @note Converting to microseconds needs two multiplications, so timed
+ *       sections only capture this and convert afterwards
+ * ------------------------------------------------------- */
+typedef struct
+{
+    uint32_t       Millis;               /**< System_millis including a pending tick */
+#if MILLIS_TICK_RATE
+    uint16_t       Us;                   /**< Microseconds above Millis carried by sub-millisecond ticks */
+#endif
+    millis_Count_T Count;                /**< Timer counts into the running tick */
+#if MILLIS_PWM_FRACT
+    millis_Fract_T Acc;                  /**< Fraction of a ms carried at the last overflow */
+#endif
+} millis_Stamp_T;
+
+/* -------------------------------------------------------
+ * @brief Tick ISR statistics (MILLIS_ISR_STATS = 1)
+ * @note All times in timer counts, one count is MILLIS_PRESCALER CPU
+ *       cycles. With a 16-bit tick timer and MILLIS_PRESCALER = 1 they
+ *       are exact CPU cycles
+ * ------------------------------------------------------- */
+typedef struct
+{
+    uint32_t Busy;        /**< Counts spent in the ISR body, summed */
+    uint32_t Periods;     /**< Tick periods covered since the last reset */
+    uint16_t Calls;       /**< ISR runs since the last reset, stops at 65535 */
+    uint16_t MaxBusy;     /**< Longest ISR body in counts */
+    uint16_t MaxLatency;  /**< Longest delay from compare match to ISR body in counts */
+} millis_IsrStats_T;
+
+/* -------------------------------------------------------
+ * @brief Record of a deadline reset (MILLIS_WATCHDOG > 0)
+ * @note Kept in .noinit, so it survives the reset it describes
+ * ------------------------------------------------------- */
+typedef struct
+{
+    uint16_t Magic;       /**< MILLIS_WDG_MAGIC while the record is unread */
+    uint8_t  Task;        /**< ID of the task that missed its deadline */
+    uint32_t Pc;          /**< Byte address the main loop was running at, 0 = unknown */
+    uint32_t Millis;      /**< System_millis when the deadline expired */
+} millis_WdgReport_T;
+
+/* -------------------------------------------------------
+ * @brief Periodic task entry for millis_Scheduler
+ * @note Keep the task table in an array, one entry per periodic job
+ * ------------------------------------------------------- */
+typedef struct
+{
+    void    (*Callback)(void);    /**< Task function, called each time Timer.Interval elapses */
+    millis_T  Timer;              /**< Interval timing of this task */
+    uint8_t   Mode;               /**< MILLIS_FIXED_DELAY (default, 0) or MILLIS_FIXED_RATE */
+} millis_Task_T;
+
+
+/* ============================================================================
+ *                         GLOBAL VARIABLES
+ * ============================================================================ */
+extern volatile uint32_t System_millis;  /**< System millisecond counter - incremented by the tick ISR */
+                                         /**< 32-bit reads are NOT atomic on AVR, use millis() instead */
+#if MILLIS_UPTIME
+extern volatile uint16_t System_millisEpoch;  /**< Rollovers of System_millis - bits 32..47 of the uptime */
+#endif
+#if MILLIS_DIVIDERS
+extern volatile uint8_t  System_tick10ms;     /**< 10ms periods, wraps after 2.56s */
+extern volatile uint8_t  System_tick100ms;    /**< 100ms periods, wraps after 25.6s */
+extern volatile uint16_t System_seconds;      /**< Seconds, wraps after ~18.2h - read with millis_Seconds() */
+extern volatile uint8_t  System_tickFlags;    /**< MILLIS_FLAG_xxx, set by the tick ISR */
+#endif
+
 
 /* ============================================================================
  *                         FUNCTION PROTOTYPES
@@ -85,10 +930,656 @@ typedef struct
 /* -------------------------------------------------------
  * @brief Initialize millisecond timing system
  * @retval None
- * @note Sets up SysTick timer for 1ms interrupt generation
+ * @note Sets up the MILLIS_TIMER timer (Timer0 by default) for MILLIS_TICK_HZ interrupt generation
  *       Must be called once before using timing functions
  *       Uses System_millis for millisecond counter access
  * ------------------------------------------------------- */
 void millis_Init(void);
 
+/* -------------------------------------------------------
+ * @brief Read microsecond timestamp
+ * @retval Microseconds since millis_Init, wraps every ~71.6 minutes
+ * @note Combines System_millis with the live timer count
+ *       Resolution is one timer count (MILLIS_PRESCALER / timer clock,
+ *       4us at 16MHz / 64)
+ *       A pending compare flag is accounted for, so the value stays
+ *       monotonic even when called with interrupts disabled
+ * @note Interrupts are disabled for a few cycles only
+ * ------------------------------------------------------- */
+uint32_t micros(void);
+
+/* -------------------------------------------------------
+ * @brief Capture a raw timestamp without converting it
+ * @param Stamp Receives System_millis and the timer count
+ * @retval None
+ * @note The same sampling as micros(), about 30 cycles including the
+ *       call. Convert with millis_Stamp_Us outside the timed section
+ * ------------------------------------------------------- */
+void millis_Stamp(millis_Stamp_T *Stamp);
+
+/* -------------------------------------------------------
+ * @brief Convert a raw timestamp to microseconds
+ * @param Stamp Timestamp taken by millis_Stamp
+ * @retval Microseconds since millis_Init, the value micros() would return
+ * ------------------------------------------------------- */
+uint32_t millis_Stamp_Us(const millis_Stamp_T *Stamp);
+
+/* -------------------------------------------------------
+ * @brief Run every due task of a task table in one pass
+ * @param Tasks Pointer to the task table
+ * @param Count Number of entries in the task table
+ * @retval Milliseconds until the next task is due (0 = a task is due now)
+ * @note One millis() snapshot is shared by all tasks of the pass
+ *       A due task is re-armed with millis_Rearm in its Mode, then its
+ *       Callback runs
+ * @note The return value already accounts for the time spent in the
+ *       callbacks, so the main loop can sleep for it directly
+ * @note With MILLIS_EVENTS the event ring is drained first, and 0 is
+ *       returned while events are still pending
+ * ------------------------------------------------------- */
+uint32_t millis_Scheduler(millis_Task_T *Tasks, uint8_t Count);
+
+/* -------------------------------------------------------
+ * @brief Sleep until a timeout elapses or any interrupt wakes the CPU
+ * @param Timeout Longest sleep in milliseconds (0 = return at once)
+ * @retval None
+ * @note Without MILLIS_TICKLESS the CPU sleeps until the next interrupt,
+ *       which is the next tick at the latest
+ * @note With MILLIS_TICKLESS the running timer period is stretched over
+ *       as many ticks as fit before Timeout and the counter top, so the
+ *       tick ISR does not wake the CPU in between. On return
+ *       System_millis has caught up with the elapsed ticks
+ * @note During a sleep window other ISRs see System_millis lagging up to
+ *       the window length, micros() stays correct
+ * @note Typical use: millis_Idle(millis_Scheduler(tasks, count));
+ * ------------------------------------------------------- */
+void millis_Idle(uint32_t Timeout);
+
+/* -------------------------------------------------------
+ * @brief Wait for a number of milliseconds in sleep
+ * @param Ms Milliseconds to wait
+ * @retval None
+ * @note Replaces while ((millis() - start) < Ms); the CPU sleeps in
+ *       MILLIS_SLEEP_MODE and only wakes for interrupts, the tick at the
+ *       latest. Other ISRs keep running as usual
+ * @note Returns when System_millis has advanced by Ms. The first tick
+ *       may be partial, so the wait is Ms minus up to one tick
+ * @note Needs global interrupts enabled, do not call from an ISR
+ * ------------------------------------------------------- */
+void millis_Delay(uint32_t Ms);
+
+/* -------------------------------------------------------
+ * @brief Wait in sleep until a condition is true or a timeout elapses
+ * @param Condition Function returning true when the wait is over, e.g.
+ *                  a check of a flag set by an ISR
+ * @param Timeout   Longest wait in milliseconds (0 = check once)
+ * @retval true if Condition became true, false on timeout
+ * @note Condition is checked with interrupts disabled right before each
+ *       sleep, so an ISR setting the flag can not be missed. Keep it to
+ *       a few reads, and never enable interrupts inside it
+ * @note Returns within one wake-up of the condition, the tick at the
+ *       latest. With MILLIS_TICKLESS the interrupt that changes the
+ *       condition ends the sleep window
+ * @note Needs global interrupts enabled, do not call from an ISR
+ * ------------------------------------------------------- */
+bool millis_WaitUntil(bool (*Condition)(void), uint32_t Timeout);
+
+#if MILLIS_UPTIME
+/* -------------------------------------------------------
+ * @brief Read the uptime split into seconds and milliseconds
+ * @param Ms Receives the milliseconds of the running second, 0..999
+ *           (may be NULL)
+ * @retval Seconds since millis_Init, wraps after ~136 years
+ * @note Works in 32-bit arithmetic only, no 64-bit division is linked
+ * ------------------------------------------------------- */
+uint32_t millis_Uptime(uint16_t *Ms);
+#endif
+
+#if MILLIS_ISR_TASKS
+/* -------------------------------------------------------
+ * @brief Run a callback from the tick ISR every Period milliseconds
+ * @param Slot     Callback slot, 0..MILLIS_ISR_TASKS-1
+ * @param Callback Function to call, runs in ISR context
+ * @param Period   Period in milliseconds, rounded down to whole ticks
+ *                 (at least one tick)
+ * @retval true if the slot was set up, false if Slot is out of range
+ * @note The first call happens Period ms after this call, then every
+ *       Period ms on the tick grid, so the jitter is the latency of the
+ *       tick interrupt itself and not the main loop
+ * @note Callbacks run with interrupts disabled, after System_millis is
+ *       updated. Keep them to a few microseconds, a long callback
+ *       delays every other interrupt and all later slots
+ * @note Overhead with MILLIS_ISR_TASKS > 0 (approximate, ATmega328P):
+ *       ~40 cycles to save the call-clobbered registers, ~10 cycles per
+ *       slot checked and ~10 cycles per callback called
+ * @note With MILLIS_TICKLESS a sleep window never covers a callback,
+ *       millis_Idle ends it on the tick the next callback is due
+ * ------------------------------------------------------- */
+bool millis_IsrTask_Start(uint8_t Slot, void (*Callback)(void), uint16_t Period);
+
+/* -------------------------------------------------------
+ * @brief Release an ISR callback slot
+ * @param Slot Callback slot, 0..MILLIS_ISR_TASKS-1
+ * @retval None
+ * @note The callback is not called again once this returns
+ * ------------------------------------------------------- */
+void millis_IsrTask_Stop(uint8_t Slot);
+#endif
+
+#if MILLIS_WATCHDOG
+/* -------------------------------------------------------
+ * @brief Start monitoring a main-loop task
+ * @param Id     Task ID, 0..MILLIS_WATCHDOG-1
+ * @param Budget Longest time in milliseconds between two kicks
+ * @retval true if started, false if Id is out of range or Budget is 0
+ * @note The tick ISR counts the deadline down, ~12 cycles per monitored
+ *       task per tick. The deadline expires between Budget and Budget
+ *       plus one tick after the last kick
+ * @note On expiry the task ID and System_millis are stored in .noinit,
+ *       monitoring stops and the hardware watchdog is armed at 16ms in
+ *       interrupt and reset mode. Its interrupt stores the address the
+ *       main loop was running at, then the watchdog resets the device
+ * @note The library defines WDT_vect and disables the watchdog in
+ *       .init3 after a reset. With the WDTON fuse programmed there is
+ *       no interrupt stage and Pc stays 0
+ * ------------------------------------------------------- */
+bool millis_Watchdog_Start(uint8_t Id, uint16_t Budget);
+
+/* -------------------------------------------------------
+ * @brief Restart the deadline of a task
+ * @param Id Task ID, 0..MILLIS_WATCHDOG-1
+ * @retval None
+ * @note Call once per pass of the task, e.g. at its end. No effect on a
+ *       stopped task
+ * ------------------------------------------------------- */
+void millis_Watchdog_Kick(uint8_t Id);
+
+/* -------------------------------------------------------
+ * @brief Stop monitoring a task
+ * @param Id Task ID, 0..MILLIS_WATCHDOG-1
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Watchdog_Stop(uint8_t Id);
+
+/* -------------------------------------------------------
+ * @brief Read the record of the last deadline reset
+ * @param Report Receives the record
+ * @retval true if the last reset was a deadline reset, false otherwise
+ * @note Call once at startup. The record is cleared by reading it
+ * @note Pc is a byte address as shown by avr-objdump -d, look it up
+ *       with avr-addr2line -e firmware.elf 0x<Pc>
+ * ------------------------------------------------------- */
+bool millis_Watchdog_Report(millis_WdgReport_T *Report);
+
+/* -------------------------------------------------------
+ * @brief Reset cause flags of the last reset
+ * @retval MCUSR as it was at the reset (RSTCTRL.RSTFR on AVR-0/1)
+ * @note .init3 has to clear WDRF in MCUSR to stop the watchdog, so
+ *       after a watchdog reset MCUSR no longer shows it. Read the cause
+ *       here instead, e.g. for millis_Trace_Init. The other flags stay
+ *       set in MCUSR until the application clears them
+ * ------------------------------------------------------- */
+uint8_t millis_Watchdog_ResetFlags(void);
+#endif
+
+#if MILLIS_ISR_STATS
+/* -------------------------------------------------------
+ * @brief Copy the tick ISR statistics
+ * @param Stats Receives a consistent copy
+ * @retval None
+ * @note Busy is measured from the first to the last statement of the
+ *       ISR body. The register save/restore (about 20 to 40 cycles) and
+ *       RETI are not included, MaxLatency includes the save
+ * ------------------------------------------------------- */
+void millis_IsrStats_Get(millis_IsrStats_T *Stats);
+
+/* -------------------------------------------------------
+ * @brief Clear the tick ISR statistics
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_IsrStats_Reset(void);
+
+/* -------------------------------------------------------
+ * @brief CPU load of the tick ISR since the last reset
+ * @retval Load in 0.01% units, 0..10000 (e.g. 125 = 1.25%)
+ * @note Busy / (Periods * MILLIS_PERIOD_COUNTS), 32-bit math only
+ * @note Resolution is one count per ISR run. With a prescaler larger
+ *       than the ISR time, the result mostly shows how often the body
+ *       runs over a count edge
+ * ------------------------------------------------------- */
+uint16_t millis_IsrLoad(void);
+#endif
+
+#if MILLIS_MISSED
+/* -------------------------------------------------------
+ * @brief Number of ticks served late since the last reset
+ * @retval Late ticks, saturates at 65535
+ * @note A tick counts as late when the ISR starts MILLIS_MISSED_LATENCY
+ *       counts or more after its compare match, or when the next match
+ *       is already pending as it returns
+ * @note One timer can not tell how many whole periods an ISR was held
+ *       off, so this is a warning counter and not an exact count of
+ *       lost ticks. A block of more than one period is caught whenever
+ *       it ends in the late part of a period or overlaps the next match,
+ *       so repeated faults always show up here
+ * ------------------------------------------------------- */
+uint16_t millis_Missed(void);
+
+/* -------------------------------------------------------
+ * @brief Clear the late tick counter
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Missed_Reset(void);
+#endif
+
+/* -------------------------------------------------------
+ * @brief Add milliseconds that were lost to System_millis
+ * @param Ms Milliseconds to add
+ * @retval None
+ * @note Optional correction: when a reference (RTC, GPS 1PPS, a host)
+ *       shows System_millis has fallen behind, add the difference here
+ *       instead of writing System_millis directly
+ * @note Counters and deadlines jump forward by Ms, interval timers that
+ *       became due run on their next check
+ * ------------------------------------------------------- */
+void millis_Catchup(uint16_t Ms);
+
+#if MILLIS_TICK_RATE
+/* -------------------------------------------------------
+ * @brief Switch the tick rate
+ * @param Hz New tick rate, 1000000 / Hz must be a whole number of
+ *           microseconds (e.g. 10000, 1000, 100)
+ * @retval true if accepted, false if the rate is not a whole number of
+ *         microseconds, shorter than 256 CPU cycles, or beyond the
+ *         largest prescaler
+ * @note The smallest prescaler that fits the period is picked, with the
+ *       same 1/65536 count fraction as millis_Calibrate for periods that
+ *       are not a whole number of counts (100Hz at 16MHz: /1024, 156.25)
+ * @note The switch is made by the next tick ISR, right after the
+ *       compare match: the counts since the match are added as time,
+ *       counter and the prescaler restart. System_millis and micros()
+ *       stay monotonic and no time is lost
+ * @note The prescaler reset (PSRSYNC) also shifts the count phase of the
+ *       other timers on the shared prescaler (Timer0/1, Timer3-5) by up
+ *       to one prescaler period, once per switch
+ * @note System_millis keeps counting milliseconds. Sub-millisecond
+ *       ticks add microseconds to an accumulator that carries into it
+ * @note millis_TickRate() returns the new rate once it is in effect,
+ *       within one tick at the old rate
+ * ------------------------------------------------------- */
+bool millis_SetTickRate(uint16_t Hz);
+
+/* -------------------------------------------------------
+ * @brief Tick rate in effect
+ * @retval Tick interrupts per second
+ * ------------------------------------------------------- */
+uint16_t millis_TickRate(void);
+#endif
+
+#if MILLIS_CALIBRATE
+/* -------------------------------------------------------
+ * @brief Trim the tick period from a reference measurement
+ * @param RefUs   True length of the measured interval in microseconds
+ * @param LocalUs Length of the same interval measured with micros()
+ * @retval Error of the local clock before the trim in ppm
+ *         (positive = local clock was fast)
+ * @note The period is scaled by LocalUs / RefUs and kept as a whole
+ *       compare value plus a 1/65536 count fraction, so the average tick
+ *       follows the reference to ~1ppm of resolution. It is clamped to
+ *       nominal +-12.5%, the range the prescaler is chosen for
+ * @note The micros() step per count follows the trim. A trim step of n
+ *       ppm moves micros() by at most n ppm of a tick when it is applied
+ * @note Suitable references: a 1PPS input, a 32.768kHz crystal on
+ *       Timer2 (count its overflows against micros), or the bit time of
+ *       a UART frame from a host with a crystal. Longer intervals give
+ *       finer results, one timer count of jitter on each end limits the
+ *       accuracy to 2 counts / RefUs
+ * ------------------------------------------------------- */
+int32_t millis_Calibrate(uint32_t RefUs, uint32_t LocalUs);
+
+/* -------------------------------------------------------
+ * @brief Stamp a reference edge
+ * @retval None
+ * @note Call from the edge interrupt (INTx, PCINT or input capture). Only
+ *       reads micros() and counts the edge, the trim itself is left to
+ *       millis_Calibrate_Edge in the main loop
+ * ------------------------------------------------------- */
+void millis_Calibrate_Stamp(void);
+
+/* -------------------------------------------------------
+ * @brief Calibrate from the edges stamped by millis_Calibrate_Stamp
+ * @param RefUs True time between two edges in microseconds,
+ *              e.g. 1000000 for a GPS 1PPS signal
+ * @retval Error in ppm as millis_Calibrate, 0 on the first edge,
+ *         MILLIS_CAL_NO_EDGE if no edge was stamped since the last call
+ * @note Call from the main loop, it costs several thousand cycles of
+ *       64-bit math. Every call after the first measures the time since
+ *       the edge the previous call used and trims the period, so the
+ *       calibration also tracks temperature drift at runtime
+ * @note Edges stamped in between are counted, so a late call measures
+ *       over n * RefUs instead of taking n edges as one
+ * ------------------------------------------------------- */
+int32_t millis_Calibrate_Edge(uint32_t RefUs);
+
+/* -------------------------------------------------------
+ * @brief Restart edge calibration with the next stamped edge
+ * @retval None
+ * @note Call after the reference was lost, so a missing edge is not taken
+ *       as a wrong interval
+ * ------------------------------------------------------- */
+void millis_Calibrate_Restart(void);
+
+#ifdef OSCCAL
+/* -------------------------------------------------------
+ * @brief Step the internal RC oscillator towards a reference
+ * @param RefUs   True length of the measured interval in microseconds
+ * @param LocalUs Length of the same interval measured with micros()
+ * @retval Error of the local clock in ppm
+ * @note Moves OSCCAL by one step when the error is above
+ *       MILLIS_CAL_OSC_PPM and leaves the tick period alone. Repeat the
+ *       measurement until it returns below the threshold, then use
+ *       millis_Calibrate for the rest. OSCCAL stays inside its current
+ *       range (bit 7 on the ATmega328P), the two ranges overlap
+ * @note The CPU clock changes with OSCCAL, so UART baud rates improve
+ *       too. Only for boards running from the internal RC oscillator
+ * ------------------------------------------------------- */
+int32_t millis_Calibrate_Osc(uint32_t RefUs, uint32_t LocalUs);
+#endif
+
+/* -------------------------------------------------------
+ * @brief Read the trimmed tick period
+ * @retval Timer counts per tick in 16.16 fixed point
+ * @note Store it (e.g. in EEPROM) to start with the last trim after a reset
+ * ------------------------------------------------------- */
+uint32_t millis_Calibrate_Get(void);
+
+/* -------------------------------------------------------
+ * @brief Set the tick period directly
+ * @param Period Timer counts per tick in 16.16 fixed point,
+ *               MILLIS_CAL_NOMINAL for the untrimmed value
+ * @retval None
+ * @note Clamped to nominal +-12.5%. Takes effect from the next tick
+ * ------------------------------------------------------- */
+void millis_Calibrate_Set(uint32_t Period);
+#endif
+
+#if MILLIS_EVENTS
+/* -------------------------------------------------------
+ * @brief Queue a handler to run in the main loop
+ * @param Handler Function to call from millis_Event_Dispatch
+ * @retval true if queued, false if the ring is full (event dropped)
+ * @note Producer side of a single-producer/single-consumer ring. Call
+ *       from ISR context only: AVR ISRs do not nest, so all ISRs
+ *       together are one producer. From the main loop call it with
+ *       interrupts disabled
+ * @note Wait-free, the slot is written before the 8-bit head index is
+ *       published, so the consumer never sees a half-written entry
+ * ------------------------------------------------------- */
+bool millis_Event_Post(void (*Handler)(void));
+
+/* -------------------------------------------------------
+ * @brief Run every queued handler in posting order
+ * @retval Number of handlers run
+ * @note Consumer side, main loop only. Interrupts stay enabled, events
+ *       posted while the handlers run are picked up in the same call
+ * @note millis_Scheduler calls this at the start of every pass
+ * ------------------------------------------------------- */
+uint8_t millis_Event_Dispatch(void);
+#endif
+
+
+/* ============================================================================
+ *                         INLINE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Read the millisecond counter without tearing
+ * @retval Current value of System_millis
+ * @note A 32-bit load is four separate byte loads on AVR, so the tick ISR
+ *       can fire halfway through and produce a value that never existed.
+ *       The counter is read twice and the read is repeated until both
+ *       copies agree. The ISR can not run twice within a few cycles, so two
+ *       equal copies are always a real counter value.
+ * @note Interrupts are never disabled, so this adds no latency to other
+ *       ISRs. Safe to call from main loop and from ISR context.
+ * ------------------------------------------------------- */
+static inline uint32_t millis(void)
+{
+    uint32_t _Snapshot;
+
+    do
+    {
+        _Snapshot = System_millis;       /**< First copy, may be torn by the tick ISR */
+    } while (_Snapshot != System_millis); /**< Retry until a second copy agrees */
+
+    return _Snapshot;
+};
+
+/* -------------------------------------------------------
+ * @brief Time since the last event of a timer
+ * @param Timer Pointer to the timer
+ * @retval millis() - Timer->Previous, rollover-safe
+ * @note Timer->Delta is not written, the value is returned instead
+ * ------------------------------------------------------- */
+static inline uint32_t millis_Elapsed(const millis_T *Timer)
+{
+    return millis() - Timer->Previous;
+};
+
+/* -------------------------------------------------------
+ * @brief Start the next interval of an expired timer
+ * @param Timer Pointer to the timer
+ * @param Now   Counter snapshot the expiry was detected with
+ * @param Mode  MILLIS_FIXED_DELAY or MILLIS_FIXED_RATE
+ * @retval None
+ * @note MILLIS_FIXED_DELAY restarts from Now, so the lateness of every
+ *       check adds up. MILLIS_FIXED_RATE moves Previous by exactly one
+ *       Interval, so a late check is made up by the next period and
+ *       the average rate is exact
+ * @note If a fixed-rate timer fell more than a whole interval behind,
+ *       it restarts from Now: missed periods are skipped, not fired
+ *       back to back
+ * @note Mode is normally a constant, the other branch is removed
+ * ------------------------------------------------------- */
+static inline void millis_Rearm(millis_T *Timer, uint32_t Now, uint8_t Mode)
+{
+    if (Mode == MILLIS_FIXED_RATE)
+    {
+        uint32_t _Next = Timer->Previous + Timer->Interval;
+
+        if ((Now - _Next) >= Timer->Interval)
+        {
+            _Next = Now;                 /**< Overrun by a whole period, resync instead of a burst */
+        }
+        Timer->Previous = _Next;
+    }
+    else
+    {
+        Timer->Previous = Now;
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief Check a timer against a snapshot and re-arm it if expired
+ * @param Timer Pointer to the timer
+ * @param Now   Counter snapshot, e.g. one millis() shared by many timers
+ * @param Mode  MILLIS_FIXED_DELAY or MILLIS_FIXED_RATE
+ * @retval true once per elapsed interval
+ * ------------------------------------------------------- */
+static inline bool millis_ExpiredAt(millis_T *Timer, uint32_t Now, uint8_t Mode)
+{
+    if ((Now - Timer->Previous) < Timer->Interval)
+    {
+        return false;
+    }
+    millis_Rearm(Timer, Now, Mode);
+    return true;
+};
+
+/* -------------------------------------------------------
+ * @brief Check a timer and re-arm it if expired
+ * @param Timer Pointer to the timer
+ * @param Mode  MILLIS_FIXED_DELAY or MILLIS_FIXED_RATE
+ * @retval true once per elapsed interval
+ * @note Takes one millis() snapshot. With many timers in one loop pass
+ *       read millis() once and use millis_ExpiredAt instead
+ * ------------------------------------------------------- */
+static inline bool millis_Expired(millis_T *Timer, uint8_t Mode)
+{
+    return millis_ExpiredAt(Timer, millis(), Mode);
+};
+
+/* -------------------------------------------------------
+ * @brief Read the low 16 bits of the millisecond counter
+ * @retval System_millis modulo 65536
+ * @note Same retry read as millis(), but only two bytes are loaded
+ * ------------------------------------------------------- */
+static inline uint16_t millis16(void)
+{
+    uint16_t _Snapshot;
+
+    do
+    {
+        _Snapshot = (uint16_t)System_millis;
+    } while (_Snapshot != (uint16_t)System_millis);
+
+    return _Snapshot;
+};
+
+/* -------------------------------------------------------
+ * @brief Read the counter in millis8_T units
+ * @retval (System_millis >> MILLIS8_SHIFT) modulo 256
+ * ------------------------------------------------------- */
+static inline uint8_t millis8(void)
+{
+    return (uint8_t)(millis16() >> MILLIS8_SHIFT);
+};
+
+/* -------------------------------------------------------
+ * @brief Time since the last event of a 16-bit timer
+ * @param Timer Pointer to the timer
+ * @retval Elapsed milliseconds, modulo 65536
+ * ------------------------------------------------------- */
+static inline uint16_t millis16_Elapsed(const millis16_T *Timer)
+{
+    return (uint16_t)(millis16() - Timer->Previous);
+};
+
+/* -------------------------------------------------------
+ * @brief Check a 16-bit timer and re-arm it when the interval is over
+ * @param Timer Pointer to the timer
+ * @retval true once per elapsed interval
+ * @note Re-arms from the current time, like the millis_T pattern
+ * ------------------------------------------------------- */
+static inline bool millis16_Expired(millis16_T *Timer)
+{
+    uint16_t _Now = millis16();
+
+    if ((uint16_t)(_Now - Timer->Previous) >= Timer->Interval)
+    {
+        Timer->Previous = _Now;
+        return true;
+    }
+    return false;
+};
+
+/* -------------------------------------------------------
+ * @brief Time since the last event of an 8-bit timer
+ * @param Timer Pointer to the timer
+ * @retval Elapsed millis8_T units, modulo 256
+ * ------------------------------------------------------- */
+static inline uint8_t millis8_Elapsed(const millis8_T *Timer)
+{
+    return (uint8_t)(millis8() - Timer->Previous);
+};
+
+/* -------------------------------------------------------
+ * @brief Check an 8-bit timer and re-arm it when the interval is over
+ * @param Timer Pointer to the timer
+ * @retval true once per elapsed interval
+ * @note Resolution is one unit, the first expiry after arming can come
+ *       up to one unit early
+ * ------------------------------------------------------- */
+static inline bool millis8_Expired(millis8_T *Timer)
+{
+    uint8_t _Now = millis8();
+
+    if ((uint8_t)(_Now - Timer->Previous) >= Timer->Interval)
+    {
+        Timer->Previous = _Now;
+        return true;
+    }
+    return false;
+};
+
+#if MILLIS_DIVIDERS
+/* -------------------------------------------------------
+ * @brief Test and clear a tick flag
+ * @param Flag MILLIS_FLAG_10MS, MILLIS_FLAG_100MS or MILLIS_FLAG_1S
+ * @retval true once after each period of that flag
+ * @note A clear flag costs one load and a test. Only a set flag is
+ *       cleared, with interrupts disabled for the read-modify-write
+ * @note Each flag suits one reader. Periods missed while the flag was
+ *       set are merged, use the counters when every period matters
+ * ------------------------------------------------------- */
+static inline bool millis_TickFlag(uint8_t Flag)
+{
+    uint8_t _Sreg;
+
+    if (!(System_tickFlags & Flag))
+    {
+        return false;
+    }
+
+    _Sreg = SREG;
+    cli();
+    System_tickFlags &= (uint8_t)~Flag;
+    SREG = _Sreg;
+    return true;
+};
+
+/* -------------------------------------------------------
+ * @brief Read the seconds counter
+ * @retval Seconds modulo 65536
+ * @note Same retry read as millis16(). The 8-bit counters need no
+ *       helper, a single byte load is atomic
+ * ------------------------------------------------------- */
+static inline uint16_t millis_Seconds(void)
+{
+    uint16_t _Snapshot;
+
+    do
+    {
+        _Snapshot = System_seconds;
+    } while (_Snapshot != System_seconds);
+
+    return _Snapshot;
+};
+#endif
+
+#if MILLIS_UPTIME
+/* -------------------------------------------------------
+ * @brief Read the 64-bit millisecond uptime
+ * @retval Milliseconds since millis_Init, wraps after ~8900 years
+ * @note The tick ISR only touches System_millisEpoch when System_millis
+ *       rolls over, so the 1kHz path stays 32 bits wide. The epoch is
+ *       read before and after millis() and the read is repeated if it
+ *       changed, so the low and high word always belong together
+ * @note Lock-free like millis(), safe from main loop and ISR context
+ * ------------------------------------------------------- */
+static inline uint64_t millis64(void)
+{
+    uint16_t _Epoch;
+    uint32_t _Low;
+
+    do
+    {
+        _Epoch = System_millisEpoch;     /**< Rollovers before the low word */
+        _Low   = millis();
+    } while (_Epoch != System_millisEpoch); /**< A rollover in between, read again */
+
+    return ((uint64_t)_Epoch << 32) | _Low;
+};
+#endif
+
 #endif /* _millis_H_ */
@@ -0,0 +1,253 @@
+/**
+ ******************************************************************************
+ * @file     millis_capture.c
+ * @brief    Edge timestamping and frequency measurement on the millis timebase
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     The ring only has a writer index. Old edges are overwritten,
+ *           which is what an average over the newest N edges needs, so
+ *           there is no overrun to handle. Readers copy the two entries
+ *           they need with interrupts disabled.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - TIMERn_CAPT_vect ISR  : Timestamp an edge latched in ICRn [MILLIS_CAPTURE_ICP]
+ *           - millis_Capture_Init   : Clear the ring and start hardware capture
+ *           - millis_Capture_Edge   : Store an edge from a pin ISR (software capture)
+ *           - millis_Capture_Reset  : Forget all stored edges
+ *           - millis_Capture_Count  : Number of stored edges
+ *           - millis_Capture_Period : Average period over the last N intervals in us
+ *           - millis_Capture_Freq   : Average frequency over the last N intervals in mHz
+ *           - millis_Capture_Age    : Time since the newest edge in us
+ *
+ * @note     RAM usage: 4 bytes per edge plus 2
+ *           (MILLIS_CAPTURE_SIZE = 16 takes 66 bytes)
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+
+#include "millis_capture.h"
+
+
+/* ============================================================================
+ *                         GLOBAL VARIABLES
+ * ============================================================================ */
+static uint32_t millis_CaptureRing[MILLIS_CAPTURE_SIZE];  /**< Edge timestamps in micros() time */
+static uint8_t  millis_CaptureHead  = 0; /**< Free-running write index */
+static uint8_t  millis_CaptureCount = 0; /**< Stored edges, saturates at MILLIS_CAPTURE_SIZE */
+
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Store one timestamp, interrupts must be disabled
+ * ------------------------------------------------------- */
+static inline void millis_Capture_Put(uint32_t _Us)
+{
+    millis_CaptureRing[millis_CaptureHead & (MILLIS_CAPTURE_SIZE - 1)] = _Us;
+    millis_CaptureHead++;
+    if (millis_CaptureCount < MILLIS_CAPTURE_SIZE)
+    {
+        millis_CaptureCount++;
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief Time between the newest and the N-th previous edge
+ * @retval true if N is valid and enough edges are stored
+ * ------------------------------------------------------- */
+static bool millis_Capture_Span(uint8_t _N, uint32_t *_Span)
+{
+    uint8_t _Sreg = SREG;
+    bool    _Valid;
+
+    if ((_N == 0) || (_N >= MILLIS_CAPTURE_SIZE))
+    {
+        return false;
+    }
+
+    cli();
+    _Valid = (millis_CaptureCount > _N);
+    if (_Valid)
+    {
+        uint8_t _Newest = (uint8_t)(millis_CaptureHead - 1);
+
+        *_Span = millis_CaptureRing[_Newest & (MILLIS_CAPTURE_SIZE - 1)] -
+                 millis_CaptureRing[(uint8_t)(_Newest - _N) & (MILLIS_CAPTURE_SIZE - 1)];
+    }
+    SREG = _Sreg;
+    return _Valid;
+};
+
+
+/* ============================================================================
+ *                         INTERRUPT SERVICE ROUTINES
+ * ============================================================================ */
+
+#if MILLIS_CAPTURE_ICP
+/* -------------------------------------------------------
+ * @brief Input capture ISR of the tick timer
+ * @retval None
+ * @note ICRn holds the count of the tick in which the edge came. If the
+ *       compare flag is set, the tick ISR is pending and System_millis
+ *       is one tick behind. The flag is read before TCNTn: a captured
+ *       count at or below the current count was then latched after the
+ *       wrap and belongs to the pending tick. A count above it was
+ *       latched just before the wrap. The capture vector has a higher
+ *       priority than compare A, so the tick ISR never runs between
+ *       the edge and this ISR when both are pending
+ * ------------------------------------------------------- */
+ISR(MILLIS_CAPT_vect)
+{
+    millis_Stamp_T _Stamp;
+    millis_Count_T _Icr = MILLIS_ICR;
+
+    _Stamp.Millis = System_millis;
+    if (bit_is_set(MILLIS_TIFR, MILLIS_OCF) && (_Icr <= MILLIS_TCNT))
+    {
+        _Stamp.Millis += MILLIS_MS_PER_TICK;  /**< Edge after the wrap, tick not counted yet */
+    }
+    _Stamp.Count = _Icr;
+
+    millis_Capture_Put(millis_Stamp_Us(&_Stamp));
+};
+#endif
+
+
+/* ============================================================================
+ *                         CAPTURE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Clear the ring and start hardware capture
+ * @param Edge MILLIS_CAPTURE_RISING or MILLIS_CAPTURE_FALLING
+ * @retval None
+ * @note Changing the edge select can set the capture flag, so the flag
+ *       is cleared afterwards
+ * ------------------------------------------------------- */
+void millis_Capture_Init(uint8_t Edge)
+{
+#if MILLIS_CAPTURE_ICP
+    uint8_t _Sreg = SREG;
+    uint8_t _Mode = 0;
+
+    if (Edge == MILLIS_CAPTURE_RISING)
+    {
+        _Mode |= (1 << MILLIS_ICES);
+    }
+    #if MILLIS_CAPTURE_NOISE
+    _Mode |= (1 << MILLIS_ICNC);
+    #endif
+
+    cli();
+    millis_CaptureHead  = 0;
+    millis_CaptureCount = 0;
+    MILLIS_TCCRB = (MILLIS_TCCRB & ~((1 << MILLIS_ICES) | (1 << MILLIS_ICNC))) | _Mode;
+    intFlag_clear(MILLIS_TIFR, MILLIS_ICF);  /**< Drop a capture from before the setup */
+    bitSet(MILLIS_TIMSK, MILLIS_ICIE);   /**< Enable interrupt on input capture */
+    SREG = _Sreg;
+#else
+    (void)Edge;
+    millis_Capture_Reset();
+#endif
+};
+
+/* -------------------------------------------------------
+ * @brief Store an edge from a pin ISR
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Capture_Edge(void)
+{
+    uint32_t _Us = micros();             /**< First, so the latency before the timestamp stays constant */
+    uint8_t  _Sreg = SREG;
+
+    cli();
+    millis_Capture_Put(_Us);
+    SREG = _Sreg;
+};
+
+/* -------------------------------------------------------
+ * @brief Forget all stored edges
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Capture_Reset(void)
+{
+    uint8_t _Sreg = SREG;
+
+    cli();
+    millis_CaptureHead  = 0;
+    millis_CaptureCount = 0;
+    SREG = _Sreg;
+};
+
+/* -------------------------------------------------------
+ * @brief Number of stored edges
+ * @retval 0..MILLIS_CAPTURE_SIZE
+ * ------------------------------------------------------- */
+uint8_t millis_Capture_Count(void)
+{
+    return millis_CaptureCount;          /**< Single byte, read atomically */
+};
+
+/* -------------------------------------------------------
+ * @brief Average period over the last N intervals
+ * @param N Intervals to average, 1..MILLIS_CAPTURE_SIZE-1
+ * @retval Period in microseconds, 0 if not enough edges are stored
+ * ------------------------------------------------------- */
+uint32_t millis_Capture_Period(uint8_t N)
+{
+    uint32_t _Span;
+
+    if (!millis_Capture_Span(N, &_Span))
+    {
+        return 0;
+    }
+    return _Span / N;
+};
+
+/* -------------------------------------------------------
+ * @brief Average frequency over the last N intervals
+ * @param N Intervals to average, 1..MILLIS_CAPTURE_SIZE-1
+ * @retval Frequency in millihertz, 0 if not enough edges are stored
+ * @note Saturates at UINT32_MAX (~4.3MHz), far above what an ISR per
+ *       edge can follow
+ * ------------------------------------------------------- */
+uint32_t millis_Capture_Freq(uint8_t N)
+{
+    uint32_t _Span;
+    uint64_t _Freq;
+
+    if (!millis_Capture_Span(N, &_Span) || (_Span == 0))
+    {
+        return 0;
+    }
+
+    _Freq = ((uint64_t)N * 1000000000ULL) / _Span;
+    return (_Freq > UINT32_MAX) ? UINT32_MAX : (uint32_t)_Freq;
+};
+
+/* -------------------------------------------------------
+ * @brief Time since the newest edge
+ * @retval Microseconds, UINT32_MAX if no edge is stored
+ * ------------------------------------------------------- */
+uint32_t millis_Capture_Age(void)
+{
+    uint32_t _Newest;
+    uint8_t  _Sreg = SREG;
+
+    cli();
+    if (millis_CaptureCount == 0)
+    {
+        SREG = _Sreg;
+        return UINT32_MAX;
+    }
+    _Newest = millis_CaptureRing[(uint8_t)(millis_CaptureHead - 1) & (MILLIS_CAPTURE_SIZE - 1)];
+    SREG = _Sreg;
+
+    return micros() - _Newest;
+};
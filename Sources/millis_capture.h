@@ -0,0 +1,174 @@
+/**
+ ******************************************************************************
+ * @file     millis_capture.h
+ * @brief    Edge timestamping and frequency measurement on the millis timebase
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     Every edge of a pulse input is stored as a micros() timestamp
+ *           in a small ring. Period and frequency are computed on demand
+ *           from the newest and the N-th previous edge, so averaging over
+ *           N edges costs nothing per pulse and the ISR only stores time.
+ *
+ *           With a 16-bit tick timer (MILLIS_TIMER 1, 3, 4 or 5) the edge
+ *           is latched by the input capture unit (ICPn pin) into ICRn, so
+ *           the timestamp is exact to one timer count no matter how late
+ *           the capture ISR runs. On other timers, or with
+ *           MILLIS_CAPTURE_ICP=0, call millis_Capture_Edge() from an INTx
+ *           or PCINT ISR instead, which takes micros() at ISR entry.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - millis_Capture_Init   : Clear the ring and start hardware capture
+ *           - millis_Capture_Edge   : Store an edge from a pin ISR (software capture)
+ *           - millis_Capture_Reset  : Forget all stored edges
+ *           - millis_Capture_Count  : Number of stored edges
+ *           - millis_Capture_Period : Average period over the last N intervals in us
+ *           - millis_Capture_Freq   : Average frequency over the last N intervals in mHz
+ *           - millis_Capture_Age    : Time since the newest edge in us
+ *
+ * @note     Configuration (compiler flags, defaults in brackets):
+ *           - MILLIS_CAPTURE_SIZE  : Edges kept, power of two 2..128 [16]
+ *           - MILLIS_CAPTURE_ICP   : 1 = input capture unit of the tick timer
+ *                                    [1 on 16-bit tick timers]
+ *           - MILLIS_CAPTURE_NOISE : 1 = input capture noise canceler, 4 clocks delay [0]
+ *
+ * @note     Example (Timer1 tick, tachometer on ICP1):
+ *           millis_Init();
+ *           millis_Capture_Init(MILLIS_CAPTURE_RISING);
+ *           globalInt_Enable();
+ *           ...
+ *           if (millis_Capture_Age() > 500000UL) rpm = 0;              // Shaft stopped
+ *           else rpm = millis_Capture_Freq(8) * 60 / 1000 / PULSES_PER_REV;
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+#ifndef _millis_capture_H_
+#define _millis_capture_H_
+
+#include "millis.h"
+
+
+/* ============================================================================
+ *                         CAPTURE CONFIGURATION
+ * ============================================================================ */
+#ifndef MILLIS_CAPTURE_SIZE
+    #define MILLIS_CAPTURE_SIZE 16       /**< Edges kept in the ring, averages span up to SIZE-1 intervals */
+#endif
+
+#if (MILLIS_CAPTURE_SIZE < 2) || (MILLIS_CAPTURE_SIZE > 128) || (MILLIS_CAPTURE_SIZE & (MILLIS_CAPTURE_SIZE - 1))
+    #error "MILLIS_CAPTURE_SIZE must be a power of two between 2 and 128"
+#endif
+
+#ifndef MILLIS_CAPTURE_ICP
+    #if (MILLIS_TIMER_BITS == 16) && !MILLIS_AVR01
+        #define MILLIS_CAPTURE_ICP  1    /**< Edges latched by the input capture unit of the tick timer */
+    #else
+        #define MILLIS_CAPTURE_ICP  0    /**< Edges stored by millis_Capture_Edge from a pin ISR */
+    #endif
+#endif
+
+#ifndef MILLIS_CAPTURE_NOISE
+    #define MILLIS_CAPTURE_NOISE    0    /**< 1 = ICNCn on, the input must be stable for 4 timer clocks */
+#endif
+
+#if MILLIS_CAPTURE_ICP && (MILLIS_TIMER_BITS != 16)
+    #error "MILLIS_CAPTURE_ICP needs a 16-bit tick timer (MILLIS_TIMER 1, 3, 4 or 5)"
+#endif
+
+#if MILLIS_CAPTURE_ICP && MILLIS_AVR01
+    #error "MILLIS_CAPTURE_ICP needs a classic 16-bit timer - on AVR-0/1 call millis_Capture_Edge from a pin ISR"
+#endif
+
+#if MILLIS_CAPTURE_ICP && MILLIS_TICKLESS
+    #error "MILLIS_CAPTURE_ICP can not be combined with MILLIS_TICKLESS - a capture inside a sleep window has no tick to refer to"
+#endif
+
+#if MILLIS_CAPTURE_ICP && MILLIS_TICK_RATE
+    #error "MILLIS_CAPTURE_ICP can not be combined with MILLIS_TICK_RATE - use millis_Capture_Edge from a pin ISR"
+#endif
+
+/* ===== Edge selection for millis_Capture_Init ===== */
+#define MILLIS_CAPTURE_FALLING  0        /**< Capture on the falling edge of ICPn */
+#define MILLIS_CAPTURE_RISING   1        /**< Capture on the rising edge of ICPn */
+
+#if MILLIS_CAPTURE_ICP
+/* ===== Input capture registers of the tick timer ===== */
+#define MILLIS_ICR              MILLIS_REG(ICR, )      /**< Captured counter value */
+#define MILLIS_ICF              MILLIS_REG(ICF, )      /**< Input capture flag */
+#define MILLIS_ICIE             MILLIS_REG(ICIE, )     /**< Input capture interrupt enable bit */
+#define MILLIS_ICES             MILLIS_REG(ICES, )     /**< Input capture edge select bit */
+#define MILLIS_ICNC             MILLIS_REG(ICNC, )     /**< Input capture noise canceler bit */
+#define MILLIS_CAPT_vect        MILLIS_PASTE(TIMER, MILLIS_TIMER, _CAPT_vect)
+#endif
+
+
+/* ============================================================================
+ *                         FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Clear the ring and start hardware capture
+ * @param Edge MILLIS_CAPTURE_RISING or MILLIS_CAPTURE_FALLING
+ *             (ignored without MILLIS_CAPTURE_ICP)
+ * @retval None
+ * @note Call after millis_Init, which rewrites TCCRnB
+ * @note With MILLIS_CAPTURE_ICP the ICPn pin (PB0 for Timer1 on the
+ *       ATmega328P) must be an input. The capture ISR takes ~100 cycles,
+ *       so edges up to ~50kHz are fine at 16MHz
+ * ------------------------------------------------------- */
+void millis_Capture_Init(uint8_t Edge);
+
+/* -------------------------------------------------------
+ * @brief Store an edge from a pin ISR
+ * @retval None
+ * @note Software capture for INTx or PCINT inputs, or for a tick timer
+ *       without input capture. The timestamp is micros() at this call,
+ *       so ISR latency becomes jitter (averaging over N edges divides it)
+ * ------------------------------------------------------- */
+void millis_Capture_Edge(void);
+
+/* -------------------------------------------------------
+ * @brief Forget all stored edges
+ * @retval None
+ * @note Call after a gap, so the first interval of a new pulse train is
+ *       not averaged with the old one
+ * ------------------------------------------------------- */
+void millis_Capture_Reset(void);
+
+/* -------------------------------------------------------
+ * @brief Number of stored edges
+ * @retval 0..MILLIS_CAPTURE_SIZE
+ * ------------------------------------------------------- */
+uint8_t millis_Capture_Count(void);
+
+/* -------------------------------------------------------
+ * @brief Average period over the last N intervals
+ * @param N Intervals to average, 1..MILLIS_CAPTURE_SIZE-1
+ * @retval Period in microseconds, 0 if fewer than N + 1 edges are stored
+ * @note (newest - N-th previous edge) / N. Only two timestamps are read,
+ *       N does not change the cost
+ * ------------------------------------------------------- */
+uint32_t millis_Capture_Period(uint8_t N);
+
+/* -------------------------------------------------------
+ * @brief Average frequency over the last N intervals
+ * @param N Intervals to average, 1..MILLIS_CAPTURE_SIZE-1
+ * @retval Frequency in millihertz (20kHz = 20000000), 0 if fewer than
+ *         N + 1 edges are stored
+ * @note N * 10^9 / span, one 64-bit division. The span keeps the full
+ *       timestamp resolution, so a larger N gives a finer result
+ * ------------------------------------------------------- */
+uint32_t millis_Capture_Freq(uint8_t N);
+
+/* -------------------------------------------------------
+ * @brief Time since the newest edge
+ * @retval Microseconds, UINT32_MAX if no edge is stored
+ * @note Period and frequency keep their last value when the input
+ *       stops, check the age to detect a stopped input
+ * ------------------------------------------------------- */
+uint32_t millis_Capture_Age(void);
+
+#endif /* _millis_capture_H_ */
@@ -0,0 +1,349 @@
+/**
+ ******************************************************************************
+ * @file     millis_clock.c
+ * @brief    UNIX wall-clock time on top of the millis uptime, with slewed sync
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     The clock reads Sec.Ms + (uptime - Anchor) + slew, where the
+ *           slew grows at MILLIS_CLOCK_SLEW_PPM of the time since the
+ *           anchor until it reaches Slew. Every set or sync moves the
+ *           anchor to the time it was made, so the state never grows.
+ *
+ * @note     Compiles to nothing unless MILLIS_UPTIME=1, so the file can
+ *           stay in the source list of a project that does not use it.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - millis_Clock_Set      : Step the clock to a given time
+ *           - millis_Clock_Sync     : Slew towards a reference valid right now
+ *           - millis_Clock_Pps      : Stamp a 1PPS edge from its ISR
+ *           - millis_Clock_SyncPps  : Slew towards the second of the last 1PPS edge
+ *           - millis_Clock_Valid    : Check if the clock was set
+ *           - millis_Clock_Unix     : UNIX time in seconds plus milliseconds
+ *           - millis_Clock_ToDate   : UNIX time to UTC date and time
+ *           - millis_Clock_FromDate : UTC date and time to UNIX time
+ *
+ * @note     The date conversion is the days-from-civil algorithm on
+ *           400-year eras (H. Hinnant), in 32-bit integers without tables.
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+
+#include "millis.h"
+
+#if MILLIS_UPTIME
+#include "millis_clock.h"
+
+
+/* ============================================================================
+ *                         TYPE DEFINITIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Clock state, copied as a whole with interrupts disabled
+ * ------------------------------------------------------- */
+typedef struct
+{
+    uint64_t Anchor;      /**< millis64() at the last set or sync */
+    uint32_t Sec;         /**< UNIX seconds at the anchor */
+    uint16_t Ms;          /**< Milliseconds at the anchor, 0..999 */
+    int16_t  Slew;        /**< Error being slewed out since the anchor, ms */
+    uint32_t SlewEnd;     /**< Milliseconds after the anchor when the slew is done */
+    bool     Valid;       /**< Clock was set */
+} millis_Clock_T;
+
+
+/* ============================================================================
+ *                         GLOBAL VARIABLES
+ * ============================================================================ */
+static millis_Clock_T    millis_ClockState = {0};    /**< Anchor and slew, written by the main loop */
+static volatile uint64_t millis_ClockPpsAt;          /**< millis64() at the last PPS edge */
+static volatile bool     millis_ClockPpsNew = false; /**< millis_ClockPpsAt not used by a sync yet */
+
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Consistent copy of the clock state
+ * ------------------------------------------------------- */
+static void millis_Clock_Get(millis_Clock_T *_State)
+{
+    uint8_t _Sreg = SREG;
+
+    cli();
+    *_State = millis_ClockState;
+    SREG = _Sreg;
+};
+
+/* -------------------------------------------------------
+ * @brief Store a new clock state
+ * @param _State Clock state to store
+ * @note A PPS edge stamped before the new anchor is dropped, its second
+ *       was measured against the old state and the reading at it would
+ *       have to run backwards from the anchor
+ * ------------------------------------------------------- */
+static void millis_Clock_Put(const millis_Clock_T *_State)
+{
+    uint8_t _Sreg = SREG;
+
+    cli();
+    millis_ClockState = *_State;
+    if (millis_ClockPpsAt < _State->Anchor)
+    {
+        millis_ClockPpsNew = false;
+    }
+    SREG = _Sreg;
+};
+
+/* -------------------------------------------------------
+ * @brief Clock reading at an uptime
+ * @param _State Clock state to read from
+ * @param _Uptime millis64() of the moment to read, not before the anchor
+ * @param _Ms Receives the milliseconds, 0..999
+ * @retval UNIX seconds
+ * @note The time since the anchor is split into seconds like in
+ *       millis_Uptime(): 2^32 ms = 4294967 s + 296 ms
+ * ------------------------------------------------------- */
+static uint32_t millis_Clock_At(const millis_Clock_T *_State, uint64_t _Uptime, uint16_t *_Ms)
+{
+    uint64_t _Since = _Uptime - _State->Anchor;
+    uint16_t _Wraps = (uint16_t)(_Since >> 32);
+    uint32_t _Low   = (uint32_t)_Since;
+    uint32_t _Sec   = _State->Sec + ((uint32_t)_Wraps * 4294967UL) + (_Low / 1000UL);
+    int32_t  _Rest  = (int32_t)_State->Ms + (int32_t)((uint32_t)_Wraps * 296UL) + (int32_t)(_Low % 1000UL);
+
+    if (_State->Slew != 0)
+    {
+        int32_t _Done = _State->Slew;
+
+        if ((_Wraps == 0) && (_Low < _State->SlewEnd))
+        {
+            _Done = (int32_t)((_Low * MILLIS_CLOCK_SLEW_PPM) / 1000000UL);  /**< _Low * PPM stays below Slew * 10^6 */
+            if (_State->Slew < 0)
+            {
+                _Done = -_Done;
+            }
+        }
+        _Rest += _Done;
+    }
+
+    _Sec  += (uint32_t)(_Rest / 1000L);  /**< _Rest >= -MILLIS_CLOCK_STEP_MS, may borrow one more below */
+    _Rest %= 1000L;
+    if (_Rest < 0)
+    {
+        _Rest += 1000L;
+        _Sec--;
+    }
+    *_Ms = (uint16_t)_Rest;
+    return _Sec;
+};
+
+/* -------------------------------------------------------
+ * @brief Correct the clock from a reference valid at an uptime
+ * @param _Unix Reference seconds
+ * @param _Ms Reference milliseconds
+ * @param _At millis64() of the moment the reference is valid
+ * @retval Error before the correction in ms, saturated
+ * @note The clock is re-anchored at _At with the value it had there, so
+ *       the rest of an old slew is part of the new error. The first
+ *       sync always steps
+ * ------------------------------------------------------- */
+static int32_t millis_Clock_Discipline(uint32_t _Unix, uint16_t _Ms, uint64_t _At)
+{
+    millis_Clock_T _State;
+    uint16_t _CurMs;
+    uint32_t _Cur;
+    int32_t  _Sec;
+    int32_t  _Err;
+
+    millis_Clock_Get(&_State);
+    _Cur = millis_Clock_At(&_State, _At, &_CurMs);
+    _Sec = (int32_t)(_Unix - _Cur);
+    if ((_Sec > 2147482L) || (_Sec < -2147482L))
+    {
+        _Err = (_Sec > 0) ? INT32_MAX : INT32_MIN;   /**< Does not fit in ms, a step anyway */
+    }
+    else
+    {
+        _Err = (_Sec * 1000L) + (int32_t)_Ms - (int32_t)_CurMs;
+    }
+
+    _State.Anchor = _At;
+    if (!_State.Valid || (_Err > MILLIS_CLOCK_STEP_MS) || (_Err < -MILLIS_CLOCK_STEP_MS))
+    {
+        _State.Valid = true;
+        _State.Sec  = _Unix;             /**< Too far off, step */
+        _State.Ms   = _Ms;
+        _State.Slew = 0;
+    }
+    else
+    {
+        uint32_t _Abs = (uint32_t)((_Err < 0) ? -_Err : _Err);
+
+        _State.Sec     = _Cur;
+        _State.Ms      = _CurMs;
+        _State.Slew    = (int16_t)_Err;
+        _State.SlewEnd = (_Abs * 1000000UL) / MILLIS_CLOCK_SLEW_PPM;
+    }
+
+    millis_Clock_Put(&_State);
+    return _Err;
+};
+
+
+/* ============================================================================
+ *                         CLOCK FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Set the clock
+ * @param Unix Seconds since 1970-01-01 00:00:00 UTC
+ * @param Ms   Milliseconds of that second, 0..999
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Clock_Set(uint32_t Unix, uint16_t Ms)
+{
+    millis_Clock_T _State;
+
+    _State.Anchor  = millis64();
+    _State.Sec     = Unix;
+    _State.Ms      = Ms;
+    _State.Slew    = 0;
+    _State.SlewEnd = 0;
+    _State.Valid   = true;
+
+    millis_Clock_Put(&_State);
+};
+
+/* -------------------------------------------------------
+ * @brief Slew the clock towards a reference valid right now
+ * @param Unix Reference time in seconds
+ * @param Ms   Milliseconds of that second, 0..999
+ * @retval Error before the correction in ms
+ * ------------------------------------------------------- */
+int32_t millis_Clock_Sync(uint32_t Unix, uint16_t Ms)
+{
+    return millis_Clock_Discipline(Unix, Ms, millis64());
+};
+
+/* -------------------------------------------------------
+ * @brief Stamp a 1PPS edge
+ * @retval None
+ * @note Called from an ISR, millis64() is lock-free
+ * ------------------------------------------------------- */
+void millis_Clock_Pps(void)
+{
+    millis_ClockPpsAt  = millis64();
+    millis_ClockPpsNew = true;
+};
+
+/* -------------------------------------------------------
+ * @brief Slew the clock towards the second that began at the last PPS edge
+ * @param Unix The second that started at the edge
+ * @retval Error before the correction in ms, MILLIS_CLOCK_NO_PPS
+ *         without a new edge
+ * @note An edge older than the last set or sync is stale and gives
+ *       MILLIS_CLOCK_NO_PPS, the clock is never read before its anchor
+ * ------------------------------------------------------- */
+int32_t millis_Clock_SyncPps(uint32_t Unix)
+{
+    uint64_t _At;
+    bool     _New;
+    uint8_t  _Sreg = SREG;
+
+    cli();
+    _At  = millis_ClockPpsAt;
+    _New = millis_ClockPpsNew && (_At >= millis_ClockState.Anchor);
+    millis_ClockPpsNew = false;
+    SREG = _Sreg;
+
+    if (!_New)
+    {
+        return MILLIS_CLOCK_NO_PPS;
+    }
+    return millis_Clock_Discipline(Unix, 0, _At);
+};
+
+/* -------------------------------------------------------
+ * @brief Check if the clock was set
+ * @retval true after millis_Clock_Set or a sync
+ * ------------------------------------------------------- */
+bool millis_Clock_Valid(void)
+{
+    return millis_ClockState.Valid;      /**< Single byte, read atomically */
+};
+
+/* -------------------------------------------------------
+ * @brief Read the UNIX time
+ * @param Ms Receives the milliseconds, 0..999 (may be NULL)
+ * @retval Seconds since 1970-01-01 00:00:00 UTC, 0 if not set
+ * ------------------------------------------------------- */
+uint32_t millis_Clock_Unix(uint16_t *Ms)
+{
+    millis_Clock_T _State;
+    uint16_t _Ms  = 0;
+    uint32_t _Sec = 0;
+
+    millis_Clock_Get(&_State);
+    if (_State.Valid)
+    {
+        _Sec = millis_Clock_At(&_State, millis64(), &_Ms);
+    }
+    if (Ms)
+    {
+        *Ms = _Ms;
+    }
+    return _Sec;
+};
+
+/* -------------------------------------------------------
+ * @brief Convert a UNIX time to a UTC date and time
+ * @param Unix Seconds since 1970-01-01 00:00:00 UTC
+ * @param Date Receives the broken-down time
+ * @retval None
+ * @note The year is shifted to start in March, so the leap day is the
+ *       last day of the year and month lengths follow a 153-day pattern
+ * ------------------------------------------------------- */
+void millis_Clock_ToDate(uint32_t Unix, millis_Date_T *Date)
+{
+    uint32_t _Days = Unix / 86400UL;
+    uint32_t _Secs = Unix % 86400UL;
+    uint32_t _Z    = _Days + 719468UL;   /**< Days since 0000-03-01 */
+    uint32_t _Era  = _Z / 146097UL;
+    uint32_t _Doe  = _Z - (_Era * 146097UL);                                          /**< Day of era, 0..146096 */
+    uint32_t _Yoe  = (_Doe - (_Doe / 1460) + (_Doe / 36524) - (_Doe / 146096)) / 365; /**< Year of era, 0..399 */
+    uint32_t _Doy  = _Doe - ((365 * _Yoe) + (_Yoe / 4) - (_Yoe / 100));               /**< Day of the March year, 0..365 */
+    uint32_t _Mp   = ((5 * _Doy) + 2) / 153;                                          /**< Month from March, 0..11 */
+
+    Date->Day     = (uint8_t)(_Doy - (((153 * _Mp) + 2) / 5) + 1);
+    Date->Month   = (uint8_t)((_Mp < 10) ? (_Mp + 3) : (_Mp - 9));
+    Date->Year    = (uint16_t)(_Yoe + (_Era * 400) + (Date->Month <= 2));
+    Date->Hour    = (uint8_t)(_Secs / 3600);
+    Date->Minute  = (uint8_t)((_Secs / 60) % 60);
+    Date->Second  = (uint8_t)(_Secs % 60);
+    Date->Weekday = (uint8_t)((_Days + 4) % 7);  /**< 1970-01-01 was a Thursday */
+};
+
+/* -------------------------------------------------------
+ * @brief Convert a UTC date and time to a UNIX time
+ * @param Date Date and time from 1970 to 2106
+ * @retval Seconds since 1970-01-01 00:00:00 UTC
+ * ------------------------------------------------------- */
+uint32_t millis_Clock_FromDate(const millis_Date_T *Date)
+{
+    uint32_t _Year = Date->Year - (Date->Month <= 2);    /**< January and February belong to the March year before */
+    uint32_t _Era  = _Year / 400;
+    uint32_t _Yoe  = _Year - (_Era * 400);
+    uint32_t _Doy  = (((153 * (uint32_t)((Date->Month > 2) ? (Date->Month - 3) : (Date->Month + 9))) + 2) / 5) + Date->Day - 1;
+    uint32_t _Doe  = (_Yoe * 365) + (_Yoe / 4) - (_Yoe / 100) + _Doy;
+    uint32_t _Days = (_Era * 146097UL) + _Doe - 719468UL;
+
+    return (_Days * 86400UL) + ((uint32_t)Date->Hour * 3600UL) + ((uint32_t)Date->Minute * 60UL) + Date->Second;
+};
+
+#endif /* MILLIS_UPTIME */
@@ -0,0 +1,178 @@
+/**
+ ******************************************************************************
+ * @file     millis_clock.h
+ * @brief    UNIX wall-clock time on top of the millis uptime, with slewed sync
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     The clock is not a counter of its own. It is an anchor (uptime
+ *           and UNIX time at the last set or sync) plus the uptime since,
+ *           so the tick ISR does no extra work and the date is only worked
+ *           out when millis_Clock_ToDate() is called.
+ *
+ *           A sync against a reference (GPS 1PPS with its NMEA time, an
+ *           NTP-like message) does not step the clock. The error is slewed
+ *           out at MILLIS_CLOCK_SLEW_PPM, so timestamps stay monotonic and
+ *           intervals between log entries stay close to real time. Only an
+ *           error above MILLIS_CLOCK_STEP_MS (or the first sync) steps.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - millis_Clock_Set      : Set the clock, stepping it
+ *           - millis_Clock_Sync     : Slew towards a reference valid right now
+ *           - millis_Clock_Pps      : Stamp a 1PPS edge, from its ISR
+ *           - millis_Clock_SyncPps  : Slew towards the second that began at the last 1PPS edge
+ *           - millis_Clock_Valid    : Check if the clock was set
+ *           - millis_Clock_Unix     : UNIX time in seconds plus milliseconds
+ *           - millis_Clock_ToDate   : Broken-down UTC date and time of a UNIX time
+ *           - millis_Clock_FromDate : UNIX time of a UTC date and time
+ *
+ * @note     Configuration (compiler flags, defaults in brackets):
+ *           - MILLIS_CLOCK_SLEW_PPM : Slew rate in ppm, 1..100000 [500]
+ *           - MILLIS_CLOCK_STEP_MS  : Larger errors are stepped, 1..4000 [1000]
+ *
+ * @note     Needs MILLIS_UPTIME=1, the anchor is kept against millis64()
+ *           so the clock does not break when System_millis wraps
+ *
+ * @note     Example (GPS receiver, PPS on INT0):
+ *           ISR(INT0_vect) { millis_Clock_Pps(); }
+ *           ...
+ *           if (nmea_Rmc(&date)) millis_Clock_SyncPps(millis_Clock_FromDate(&date));
+ *           ...
+ *           millis_Clock_ToDate(millis_Clock_Unix(NULL), &now);
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+#ifndef _millis_clock_H_
+#define _millis_clock_H_
+
+#include "millis.h"
+
+
+/* ============================================================================
+ *                         CLOCK CONFIGURATION
+ * ============================================================================ */
+#if !MILLIS_UPTIME
+    #error "millis_clock.h needs MILLIS_UPTIME=1 - the clock is kept against the 64-bit uptime"
+#endif
+
+#ifndef MILLIS_CLOCK_SLEW_PPM
+    #define MILLIS_CLOCK_SLEW_PPM   500UL    /**< Slew rate, 500ppm takes 2s to correct 1ms */
+#endif
+
+#ifndef MILLIS_CLOCK_STEP_MS
+    #define MILLIS_CLOCK_STEP_MS    1000L    /**< Errors above this are stepped instead of slewed */
+#endif
+
+#if (MILLIS_CLOCK_SLEW_PPM < 1) || (MILLIS_CLOCK_SLEW_PPM > 100000)
+    #error "MILLIS_CLOCK_SLEW_PPM must be between 1 and 100000"
+#endif
+
+#if (MILLIS_CLOCK_STEP_MS < 1) || (MILLIS_CLOCK_STEP_MS > 4000)
+    #error "MILLIS_CLOCK_STEP_MS must be between 1 and 4000 (the slew math is 32 bits wide)"
+#endif
+
+#define MILLIS_CLOCK_NO_PPS     INT32_MIN    /**< Returned by millis_Clock_SyncPps without a new edge */
+
+
+/* ============================================================================
+ *                         TYPE DEFINITIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Broken-down UTC date and time
+ * ------------------------------------------------------- */
+typedef struct
+{
+    uint16_t Year;        /**< 1970..2106 */
+    uint8_t  Month;       /**< 1..12 */
+    uint8_t  Day;         /**< 1..31 */
+    uint8_t  Hour;        /**< 0..23 */
+    uint8_t  Minute;      /**< 0..59 */
+    uint8_t  Second;      /**< 0..59 */
+    uint8_t  Weekday;     /**< 0 = Sunday .. 6 = Saturday, ignored by millis_Clock_FromDate */
+} millis_Date_T;
+
+
+/* ============================================================================
+ *                         FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Set the clock
+ * @param Unix Seconds since 1970-01-01 00:00:00 UTC
+ * @param Ms   Milliseconds of that second, 0..999
+ * @retval None
+ * @note Steps the clock and drops a slew in progress. Use it for a
+ *       manual set, millis_Clock_Sync for a reference that repeats
+ * ------------------------------------------------------- */
+void millis_Clock_Set(uint32_t Unix, uint16_t Ms);
+
+/* -------------------------------------------------------
+ * @brief Slew the clock towards a reference
+ * @param Unix Reference time in seconds
+ * @param Ms   Milliseconds of that second, 0..999
+ * @retval Error before the correction in ms (reference minus clock),
+ *         saturated to INT32_MIN..INT32_MAX
+ * @note The reference must be valid at this call. Errors up to
+ *       MILLIS_CLOCK_STEP_MS are slewed, larger ones (and the first
+ *       sync) step the clock
+ * @note A new sync replaces the rest of the previous slew, the error is
+ *       measured against the clock as it reads at that moment
+ * ------------------------------------------------------- */
+int32_t millis_Clock_Sync(uint32_t Unix, uint16_t Ms);
+
+/* -------------------------------------------------------
+ * @brief Stamp a 1PPS edge
+ * @retval None
+ * @note Call from the ISR of the PPS input. The uptime of the edge is
+ *       kept until millis_Clock_SyncPps() gets the second it started
+ * ------------------------------------------------------- */
+void millis_Clock_Pps(void);
+
+/* -------------------------------------------------------
+ * @brief Slew the clock towards the second that began at the last PPS edge
+ * @param Unix The second that started at the edge (e.g. from NMEA)
+ * @retval Error before the correction in ms, MILLIS_CLOCK_NO_PPS if no
+ *         edge was stamped since the last call or since the last
+ *         millis_Clock_Set() / millis_Clock_Sync()
+ * @note The error is measured at the edge, so the delay until the
+ *       message is parsed does not matter
+ * ------------------------------------------------------- */
+int32_t millis_Clock_SyncPps(uint32_t Unix);
+
+/* -------------------------------------------------------
+ * @brief Check if the clock was set
+ * @retval true after millis_Clock_Set or a sync
+ * ------------------------------------------------------- */
+bool millis_Clock_Valid(void);
+
+/* -------------------------------------------------------
+ * @brief Read the UNIX time
+ * @param Ms Receives the milliseconds of the running second, 0..999
+ *           (may be NULL)
+ * @retval Seconds since 1970-01-01 00:00:00 UTC, 0 if the clock was not set
+ * @note Works in 32-bit arithmetic apart from one 64-bit subtraction,
+ *       no 64-bit division is linked
+ * ------------------------------------------------------- */
+uint32_t millis_Clock_Unix(uint16_t *Ms);
+
+/* -------------------------------------------------------
+ * @brief Convert a UNIX time to a UTC date and time
+ * @param Unix Seconds since 1970-01-01 00:00:00 UTC
+ * @param Date Receives the broken-down time
+ * @retval None
+ * @note Add the zone offset in seconds to Unix for local time
+ * ------------------------------------------------------- */
+void millis_Clock_ToDate(uint32_t Unix, millis_Date_T *Date);
+
+/* -------------------------------------------------------
+ * @brief Convert a UTC date and time to a UNIX time
+ * @param Date Date from 1970-01-01 to 2106-02-07, fields not range checked
+ * @retval Seconds since 1970-01-01 00:00:00 UTC
+ * ------------------------------------------------------- */
+uint32_t millis_Clock_FromDate(const millis_Date_T *Date);
+
+#endif /* _millis_clock_H_ */
@@ -0,0 +1,225 @@
+/**
+ ******************************************************************************
+ * @file     millis_host.c
+ * @brief    Simulated Timer0 for the host (x86) build of the millis library
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     Compiles to nothing unless MILLIS_HOST=1, so the file can stay
+ *           in the source list of an AVR project.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - millis_Host_Run    : Advance the prescaler and TCNT0, run the compare ISR
+ *           - millis_Host_RunUs  : millis_Host_Run in microseconds
+ *           - millis_Host_Cycles : CPU cycles simulated since start
+ *           - millis_Host_Ticks  : Compare ISRs run since start
+ *           - millis_Host_Sei    : sei(), runs a pending compare ISR
+ *           - millis_Host_Sleep  : sleep_cpu(), runs to the next compare match
+ *
+ * @note     The counter is not stepped count by count. Each pass of
+ *           millis_Host_Run jumps straight to the next compare match (or
+ *           the wrap when TCNT0 is above OCR0A), so simulating an hour at
+ *           1kHz costs 3.6 million loop passes, not 900 million.
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+
+#include "millis.h"
+
+#if MILLIS_HOST
+
+
+/* ============================================================================
+ *                         GLOBAL VARIABLES
+ * ============================================================================ */
+volatile uint8_t SREG   = 0;             /**< Interrupts disabled after reset, as on the device */
+volatile uint8_t TCCR0A = 0;
+volatile uint8_t TCCR0B = 0;             /**< Timer stopped until millis_Init */
+volatile uint8_t TCNT0  = 0;
+volatile uint8_t OCR0A  = 0;
+volatile uint8_t TIMSK0 = 0;
+volatile uint8_t TIFR0  = 0;
+volatile uint8_t GTCCR  = 0;
+
+static uint64_t millis_HostCycles = 0;   /**< CPU cycles simulated since start */
+static uint32_t millis_HostTicks  = 0;   /**< Compare ISRs run since start */
+static uint16_t millis_HostPhase  = 0;   /**< CPU cycles into the current prescaler period */
+
+void MILLIS_COMPA_vect(void);            /**< Tick ISR in millis.c, a plain function here */
+
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief CPU cycles per timer count for the clock select in TCCR0B
+ * @retval 0 if the timer is stopped (or clocked from T0, not simulated)
+ * ------------------------------------------------------- */
+static uint16_t millis_Host_Prescaler(void)
+{
+    static const uint16_t _Div[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+
+    return _Div[TCCR0B & 0x07];
+};
+
+/* -------------------------------------------------------
+ * @brief Run the compare ISR if it is pending and enabled
+ * @retval None
+ * @note The device clears the flag and the I bit on entry and sets
+ *       the I bit again with RETI
+ * ------------------------------------------------------- */
+static void millis_Host_Dispatch(void)
+{
+    if (bit_is_set(SREG, SREG_I) && bit_is_set(TIMSK0, OCIE0A) && bit_is_set(TIFR0, OCF0A))
+    {
+        bitClear(TIFR0, OCF0A);
+        cli();
+        millis_HostTicks++;
+        MILLIS_COMPA_vect();
+        bitSet(SREG, SREG_I);
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief Timer counts until TCNT0 next wraps to 0
+ * @param _Match Set to true if the wrap is a compare match
+ * ------------------------------------------------------- */
+static uint16_t millis_Host_ToWrap(bool *_Match)
+{
+    *_Match = (TCNT0 <= OCR0A);
+    if (*_Match)
+    {
+        return (uint16_t)(OCR0A - TCNT0 + 1);   /**< Up to OCR0A, then cleared by the match */
+    }
+    return (uint16_t)(256 - TCNT0);      /**< OCR0A moved below TCNT0: counts on to 0xFF first */
+};
+
+
+/* ============================================================================
+ *                         HOST FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Advance simulated time
+ * @param Cycles CPU cycles at F_CPU
+ * @retval None
+ * @note A PSRSYNC write takes effect here, before any cycle passes,
+ *       which is where the device applies it too
+ * ------------------------------------------------------- */
+void millis_Host_Run(uint32_t Cycles)
+{
+    millis_HostCycles += Cycles;
+    millis_Host_Dispatch();              /**< A match left pending by cli() */
+
+    while (Cycles)
+    {
+        uint16_t _Div;
+        uint16_t _Counts;
+        uint32_t _Need;
+        bool     _Match;
+
+        if (bit_is_set(GTCCR, PSRSYNC))
+        {
+            bitClear(GTCCR, PSRSYNC);
+            millis_HostPhase = 0;
+        }
+        _Div = millis_Host_Prescaler();
+        if (_Div == 0)
+        {
+            return;                      /**< Timer stopped, time passes without counts */
+        }
+
+        _Counts = millis_Host_ToWrap(&_Match);
+        _Need   = ((uint32_t)_Counts * _Div) - millis_HostPhase;
+        if (Cycles < _Need)
+        {
+            uint32_t _Total = millis_HostPhase + Cycles;
+
+            TCNT0 = (uint8_t)(TCNT0 + (_Total / _Div));
+            millis_HostPhase = (uint16_t)(_Total % _Div);
+            return;
+        }
+
+        Cycles -= _Need;
+        millis_HostPhase = 0;
+        TCNT0 = 0;
+        if (_Match)
+        {
+            bitSet(TIFR0, OCF0A);
+        }
+        else
+        {
+            bitSet(TIFR0, TOV0);
+        }
+        millis_Host_Dispatch();          /**< May change OCR0A, TCCR0B or TCNT0 for the next pass */
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief Advance simulated time
+ * @param Us Microseconds
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Host_RunUs(uint32_t Us)
+{
+    uint64_t _Cycles = ((uint64_t)Us * (F_CPU)) / 1000000ULL;
+
+    while (_Cycles > UINT32_MAX)
+    {
+        millis_Host_Run(UINT32_MAX);
+        _Cycles -= UINT32_MAX;
+    }
+    millis_Host_Run((uint32_t)_Cycles);
+};
+
+/* -------------------------------------------------------
+ * @brief CPU cycles simulated since start
+ * @retval Cycle count
+ * ------------------------------------------------------- */
+uint64_t millis_Host_Cycles(void)
+{
+    return millis_HostCycles;
+};
+
+/* -------------------------------------------------------
+ * @brief Compare ISRs run since start
+ * @retval ISR count
+ * ------------------------------------------------------- */
+uint32_t millis_Host_Ticks(void)
+{
+    return millis_HostTicks;
+};
+
+/* -------------------------------------------------------
+ * @brief Set the I bit and run a pending compare ISR
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Host_Sei(void)
+{
+    bitSet(SREG, SREG_I);
+    millis_Host_Dispatch();
+};
+
+/* -------------------------------------------------------
+ * @brief Sleep until the next interrupt
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Host_Sleep(void)
+{
+    uint32_t _Ticks = millis_HostTicks;
+
+    while ((_Ticks == millis_HostTicks) && bit_is_set(SREG, SREG_I) &&
+           bit_is_set(TIMSK0, OCIE0A) && (millis_Host_Prescaler() != 0))
+    {
+        bool     _Match;
+        uint16_t _Counts = millis_Host_ToWrap(&_Match);
+
+        millis_Host_Run(((uint32_t)_Counts * millis_Host_Prescaler()) - millis_HostPhase);
+    }
+};
+
+#endif /* MILLIS_HOST */
@@ -0,0 +1,161 @@
+/**
+ ******************************************************************************
+ * @file     millis_host.h
+ * @brief    Host (x86) port of the millis library with a simulated Timer0
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     Included by millis.h in place of aKaReZa.h when the library is
+ *           built with -DMILLIS_HOST=1. It provides the few AVR names the
+ *           library uses (Timer0 registers and bits, SREG, cli/sei, ISR,
+ *           the sleep and watchdog macros) as plain RAM and functions, so
+ *           millis.c and the add-on modules (queue, profile, capture,
+ *           clock, trace) compile unchanged with the host compiler.
+ *
+ *           Time only moves when the program calls millis_Host_Run(). It
+ *           advances the simulated prescaler and TCNT0 by a number of CPU
+ *           cycles and runs the compare ISR at every match while the I bit
+ *           is set, exactly as often as the device would. There is no
+ *           thread and no wall clock behind it, so a test sees the same
+ *           sequence of ticks on every run.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - millis_Host_Run    : Advance simulated time by a number of CPU cycles
+ *           - millis_Host_RunUs  : Advance simulated time by microseconds
+ *           - millis_Host_Cycles : CPU cycles simulated since start
+ *           - millis_Host_Ticks  : Compare ISRs run since start
+ *           - millis_Host_Sleep  : sleep_cpu(), run to the next interrupt
+ *
+ * @note     Supported: Timer0 in CTC mode with the C tick ISR, which
+ *           covers MILLIS_FRACTIONAL, MILLIS_TICKLESS, MILLIS_CALIBRATE,
+ *           MILLIS_TICK_RATE and all features on top of the tick. Not
+ *           supported: MILLIS_TIMER other than 0, MILLIS_PWM, MILLIS_RTC,
+ *           MILLIS_ISR_NAKED and MILLIS_WATCHDOG (inline assembly, WDT)
+ *
+ * @note     The ISR takes no simulated time. A tick that the device would
+ *           serve late is served on time here, so MILLIS_MISSED never
+ *           counts and MILLIS_ISR_STATS reports the count at entry only
+ *
+ * @note     Example (host test of the 2^32 wraparound):
+ *           millis_Init();
+ *           sei();
+ *           System_millis = UINT32_MAX - 5;        // Jump close to the wrap
+ *           millis_Host_RunUs(10000);
+ *           assert(millis() == 4);                 // 10 ticks later
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+#ifndef _millis_host_H_
+#define _millis_host_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/* ============================================================================
+ *                         SIMULATED REGISTERS
+ * ============================================================================
+ *  Only what the library touches on Timer0. Flag registers are plain RAM
+ *  here, a bit is cleared by writing 0 (intFlag_clear below), not 1.
+ * ============================================================================ */
+extern volatile uint8_t SREG;            /**< Bit 7 = global interrupt enable */
+extern volatile uint8_t TCCR0A;          /**< Waveform mode, WGM01 = CTC */
+extern volatile uint8_t TCCR0B;          /**< Clock select CS02:CS00 */
+extern volatile uint8_t TCNT0;           /**< Counter, advanced by millis_Host_Run */
+extern volatile uint8_t OCR0A;           /**< Compare value, top in CTC mode */
+extern volatile uint8_t TIMSK0;          /**< Interrupt mask */
+extern volatile uint8_t TIFR0;           /**< Interrupt flags */
+extern volatile uint8_t GTCCR;           /**< PSRSYNC restarts the prescaler */
+
+/* ===== Register bits ===== */
+#define SREG_I                  7        /**< Global interrupt enable */
+#define WGM00                   0
+#define WGM01                   1
+#define WGM02                   3
+#define CS00                    0
+#define CS01                    1
+#define CS02                    2
+#define TOIE0                   0
+#define OCIE0A                  1
+#define TOV0                    0
+#define OCF0A                   1
+#define PSRSYNC                 0
+
+/* ===== avr-libc helpers ===== */
+#define _BV(_Bit)               (1 << (_Bit))
+#define bit_is_set(_Reg, _Bit)  ((_Reg) & _BV(_Bit))
+#define bit_is_clear(_Reg, _Bit) (!((_Reg) & _BV(_Bit)))
+
+#define ISR(_Vector, ...)       void _Vector(void); void _Vector(void)
+#define cli()                   (SREG &= (uint8_t)~_BV(SREG_I))
+#define sei()                   millis_Host_Sei()
+
+/* ===== Sleep and watchdog, see millis_Host_Sleep ===== */
+#define SLEEP_MODE_IDLE         0
+#define set_sleep_mode(_Mode)   ((void)(_Mode))
+#define sleep_enable()          ((void)0)
+#define sleep_disable()         ((void)0)
+#define sleep_cpu()             millis_Host_Sleep()
+#define wdt_reset()             ((void)0)
+
+/* ===== aKaReZa.h macros used by the library ===== */
+#define bitSet(_Reg, _Bit)        ((_Reg) |=  (1 << (_Bit)))
+#define bitClear(_Reg, _Bit)      ((_Reg) &= ~(1 << (_Bit)))
+#define intFlag_clear(_Reg, _Bit) ((_Reg) &= ~(1 << (_Bit)))
+#define globalInt_Enable          sei()
+#define globalInt_Disable         cli()
+
+
+/* ============================================================================
+ *                         FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Advance simulated time
+ * @param Cycles CPU cycles at F_CPU
+ * @retval None
+ * @note The prescaler keeps its phase between calls, so many short calls
+ *       give the same ticks as one long call. A compare match with the
+ *       I bit clear leaves OCF0A pending, the ISR runs at the next
+ *       millis_Host_Run or sei()
+ * ------------------------------------------------------- */
+void millis_Host_Run(uint32_t Cycles);
+
+/* -------------------------------------------------------
+ * @brief Advance simulated time
+ * @param Us Microseconds, converted with F_CPU
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Host_RunUs(uint32_t Us);
+
+/* -------------------------------------------------------
+ * @brief CPU cycles simulated since start
+ * @retval Cycle count, the reference for micros() error checks
+ * ------------------------------------------------------- */
+uint64_t millis_Host_Cycles(void);
+
+/* -------------------------------------------------------
+ * @brief Compare ISRs run since start
+ * @retval ISR count, e.g. to check that tickless idle skipped ticks
+ * ------------------------------------------------------- */
+uint32_t millis_Host_Ticks(void);
+
+/* -------------------------------------------------------
+ * @brief Set the I bit and run a pending compare ISR
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Host_Sei(void);
+
+/* -------------------------------------------------------
+ * @brief Sleep until the next interrupt
+ * @retval None
+ * @note Runs to the next compare match, like idle sleep woken by the
+ *       tick. Returns at once if the timer is stopped or its interrupt
+ *       is masked, as there is no other interrupt to wait for
+ * ------------------------------------------------------- */
+void millis_Host_Sleep(void);
+
+#endif /* _millis_host_H_ */
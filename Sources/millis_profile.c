@@ -0,0 +1,200 @@
+/**
+ ******************************************************************************
+ * @file     millis_profile.c
+ * @brief    Section and ISR profiling on top of the millis library
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     The start of every probe is kept as a raw millis_Stamp_T. Both
+ *           stamps are converted with millis_Stamp_Us in End, and the
+ *           difference is taken in 32 bits, so a section may run over
+ *           tick boundaries and the micros() rollover.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - millis_Profile_Reset : Clear the statistics of all probes
+ *           - millis_Profile_Begin : Mark the start of a probed section
+ *           - millis_Profile_End   : Mark the end and update the statistics
+ *           - millis_Profile_Get   : Copy the statistics of one probe
+ *           - millis_Profile_Dump  : Print all used probes through a putc callback
+ *
+ * @note     RAM usage: about 20 bytes per probe
+ *           (MILLIS_PROFILE_SIZE = 8 on ATmega328P takes ~160 bytes)
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+
+#include "millis_profile.h"
+
+
+/* ============================================================================
+ *                         GLOBAL VARIABLES
+ * ============================================================================ */
+static millis_Stamp_T   millis_ProfileStart[MILLIS_PROFILE_SIZE];  /**< Raw stamp of the last Begin per probe */
+static millis_Profile_T millis_ProfileStats[MILLIS_PROFILE_SIZE];  /**< Statistics per probe */
+
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Print a string through the putc callback
+ * ------------------------------------------------------- */
+static void millis_Profile_PutStr(void (*Putc)(char), const char *_Str)
+{
+    while (*_Str)
+    {
+        Putc(*_Str++);
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief Print an unsigned number in decimal through the putc callback
+ * ------------------------------------------------------- */
+static void millis_Profile_PutNum(void (*Putc)(char), uint32_t _Value)
+{
+    char    _Digits[10];                 /**< UINT32_MAX has 10 digits */
+    uint8_t _Len = 0;
+
+    do
+    {
+        _Digits[_Len++] = (char)('0' + (_Value % 10));
+        _Value /= 10;
+    } while (_Value);
+
+    while (_Len)
+    {
+        Putc(_Digits[--_Len]);
+    }
+};
+
+
+/* ============================================================================
+ *                         PROFILE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Clear the statistics of all probes
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Profile_Reset(void)
+{
+    uint8_t _Sreg = SREG;
+
+    cli();
+    for (uint8_t _Id = 0; _Id < MILLIS_PROFILE_SIZE; _Id++)
+    {
+        millis_ProfileStats[_Id].Min   = UINT32_MAX;
+        millis_ProfileStats[_Id].Max   = 0;
+        millis_ProfileStats[_Id].Total = 0;
+        millis_ProfileStats[_Id].Count = 0;
+    }
+    SREG = _Sreg;
+};
+
+/* -------------------------------------------------------
+ * @brief Mark the start of a probed section
+ * @param Id Probe ID, 0..MILLIS_PROFILE_SIZE-1
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Profile_Begin(uint8_t Id)
+{
+    if (Id < MILLIS_PROFILE_SIZE)
+    {
+        millis_Stamp(&millis_ProfileStart[Id]);
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief Mark the end of a probed section and update its statistics
+ * @param Id Probe ID, 0..MILLIS_PROFILE_SIZE-1
+ * @retval Duration of this pass in microseconds
+ * ------------------------------------------------------- */
+uint32_t millis_Profile_End(uint8_t Id)
+{
+    millis_Stamp_T    _End;
+    millis_Profile_T *_Stats;
+    uint32_t          _Us;
+
+    millis_Stamp(&_End);                 /**< First, so nothing below is measured */
+
+    if (Id >= MILLIS_PROFILE_SIZE)
+    {
+        return 0;
+    }
+
+    _Us    = millis_Stamp_Us(&_End) - millis_Stamp_Us(&millis_ProfileStart[Id]);
+    _Stats = &millis_ProfileStats[Id];
+
+    if (_Us < _Stats->Min)
+    {
+        _Stats->Min = _Us;
+    }
+    if (_Us > _Stats->Max)
+    {
+        _Stats->Max = _Us;
+    }
+    if ((_Stats->Count < UINT16_MAX) && ((_Stats->Total + _Us) >= _Stats->Total))
+    {
+        _Stats->Total += _Us;            /**< Count and Total stop together, the average stays valid */
+        _Stats->Count++;
+    }
+    return _Us;
+};
+
+/* -------------------------------------------------------
+ * @brief Copy the statistics of one probe
+ * @param Id    Probe ID, 0..MILLIS_PROFILE_SIZE-1
+ * @param Stats Receives a consistent copy
+ * @retval true if copied, false if Id is out of range
+ * ------------------------------------------------------- */
+bool millis_Profile_Get(uint8_t Id, millis_Profile_T *Stats)
+{
+    uint8_t _Sreg = SREG;
+
+    if (Id >= MILLIS_PROFILE_SIZE)
+    {
+        return false;
+    }
+
+    cli();
+    *Stats = millis_ProfileStats[Id];
+    SREG = _Sreg;
+    return true;
+};
+
+/* -------------------------------------------------------
+ * @brief Print every probe that has run through a putc callback
+ * @param Putc Function writing one character
+ * @retval None
+ * @note Each probe is copied first, so the slow printing runs with
+ *       interrupts enabled
+ * ------------------------------------------------------- */
+void millis_Profile_Dump(void (*Putc)(char))
+{
+    millis_Profile_T _Stats;
+
+    for (uint8_t _Id = 0; _Id < MILLIS_PROFILE_SIZE; _Id++)
+    {
+        millis_Profile_Get(_Id, &_Stats);
+        if (_Stats.Count == 0)
+        {
+            continue;                    /**< Probe never completed, nothing to show */
+        }
+
+        Putc('P');
+        millis_Profile_PutNum(Putc, _Id);
+        millis_Profile_PutStr(Putc, " n=");
+        millis_Profile_PutNum(Putc, _Stats.Count);
+        millis_Profile_PutStr(Putc, " min=");
+        millis_Profile_PutNum(Putc, _Stats.Min);
+        millis_Profile_PutStr(Putc, " avg=");
+        millis_Profile_PutNum(Putc, _Stats.Total / _Stats.Count);
+        millis_Profile_PutStr(Putc, " max=");
+        millis_Profile_PutNum(Putc, _Stats.Max);
+        millis_Profile_PutStr(Putc, "\r\n");
+    }
+};
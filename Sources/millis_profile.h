@@ -0,0 +1,125 @@
+/**
+ ******************************************************************************
+ * @file     millis_profile.h
+ * @brief    Section and ISR profiling on top of the millis library
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     Each probe is a Begin/End pair around a code section. Begin
+ *           only captures a raw (System_millis, timer count) pair with
+ *           millis_Stamp, End captures the second pair first and does
+ *           all the math afterwards, so the conversion is never part of
+ *           the measured time. Per probe the count, minimum, maximum and
+ *           total duration are kept in a static table.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - millis_Profile_Reset : Clear the statistics of all probes
+ *           - millis_Profile_Begin : Mark the start of a probed section
+ *           - millis_Profile_End   : Mark the end and update the statistics
+ *           - millis_Profile_Get   : Copy the statistics of one probe
+ *           - millis_Profile_Dump  : Print all used probes through a putc callback
+ *
+ * @note     Configuration (compiler flags, defaults in brackets):
+ *           - MILLIS_PROFILE_SIZE : Number of probes, 1..255 [8]
+ *
+ * @note     Example:
+ *           millis_Profile_Reset();
+ *           while (1) {
+ *               millis_Profile_Begin(PROBE_CONTROL);      // Probe ID 0..MILLIS_PROFILE_SIZE-1
+ *               control_Loop();
+ *               millis_Profile_End(PROBE_CONTROL);
+ *               if (report_Due) millis_Profile_Dump(uart_Putc);
+ *           }
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+#ifndef _millis_profile_H_
+#define _millis_profile_H_
+
+#include "millis.h"
+
+
+/* ============================================================================
+ *                         PROFILE CONFIGURATION
+ * ============================================================================ */
+#ifndef MILLIS_PROFILE_SIZE
+    #define MILLIS_PROFILE_SIZE 8        /**< Number of probes (IDs 0..MILLIS_PROFILE_SIZE-1) */
+#endif
+
+#if (MILLIS_PROFILE_SIZE < 1) || (MILLIS_PROFILE_SIZE > 255)
+    #error "MILLIS_PROFILE_SIZE must be between 1 and 255"
+#endif
+
+
+/* ============================================================================
+ *                         TYPE DEFINITIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Statistics of one probe
+ * @note All durations in microseconds, resolution one timer count
+ *       (4us at 16MHz / 64)
+ * ------------------------------------------------------- */
+typedef struct
+{
+    uint32_t Min;         /**< Shortest duration, UINT32_MAX while Count is 0 */
+    uint32_t Max;         /**< Longest duration */
+    uint32_t Total;       /**< Sum of all durations, for the average */
+    uint16_t Count;       /**< Number of completed Begin/End pairs */
+} millis_Profile_T;
+
+
+/* ============================================================================
+ *                         FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Clear the statistics of all probes
+ * @retval None
+ * @note Call once before profiling, and again to start a new run
+ * ------------------------------------------------------- */
+void millis_Profile_Reset(void);
+
+/* -------------------------------------------------------
+ * @brief Mark the start of a probed section
+ * @param Id Probe ID, 0..MILLIS_PROFILE_SIZE-1
+ * @retval None
+ * @note Only captures a millis_Stamp, a few dozen cycles including the
+ *       call. Safe in ISRs, use a separate probe ID per context
+ * ------------------------------------------------------- */
+void millis_Profile_Begin(uint8_t Id);
+
+/* -------------------------------------------------------
+ * @brief Mark the end of a probed section and update its statistics
+ * @param Id Probe ID, 0..MILLIS_PROFILE_SIZE-1
+ * @retval Duration of this pass in microseconds (0 if Id is out of range)
+ * @note The end stamp is taken first, the conversion and the statistics
+ *       update run after it and are not measured
+ * @note Count and Total stop at the first overflow (65535 passes or
+ *       ~71 minutes in total), Min and Max keep updating
+ * ------------------------------------------------------- */
+uint32_t millis_Profile_End(uint8_t Id);
+
+/* -------------------------------------------------------
+ * @brief Copy the statistics of one probe
+ * @param Id    Probe ID, 0..MILLIS_PROFILE_SIZE-1
+ * @param Stats Receives a consistent copy
+ * @retval true if copied, false if Id is out of range
+ * @note Copied with interrupts disabled, so a probe inside an ISR can
+ *       not change it halfway. Average = Stats.Total / Stats.Count
+ * ------------------------------------------------------- */
+bool millis_Profile_Get(uint8_t Id, millis_Profile_T *Stats);
+
+/* -------------------------------------------------------
+ * @brief Print every probe that has run through a putc callback
+ * @param Putc Function writing one character, e.g. a blocking UART send
+ * @retval None
+ * @note One line per probe: "P<id> n=<count> min=<us> avg=<us> max=<us>"
+ *       and CR LF. No printf, so no stdio code is linked in
+ * ------------------------------------------------------- */
+void millis_Profile_Dump(void (*Putc)(char));
+
+#endif /* _millis_profile_H_ */
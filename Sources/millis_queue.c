@@ -0,0 +1,255 @@
+/**
+ ******************************************************************************
+ * @file     millis_queue.c
+ * @brief    Deadline-sorted software timer queue on top of the millis library
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     The queue is a binary min-heap of timer IDs. The expiry time of
+ *           each ID is kept in a separate table, so sifting only moves one
+ *           byte per level. A position table maps each ID back to its heap
+ *           slot, which makes cancel and re-arm O(log n) without a search.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - millis_Queue_Init   : Clear the queue, all timers inactive
+ *           - millis_Queue_Start  : Arm (or re-arm) a timer for a timeout
+ *           - millis_Queue_Cancel : Stop a timer
+ *           - millis_Queue_Active : Check if a timer is armed
+ *           - millis_Queue_Poll   : Pop the next expired timer
+ *           - millis_Queue_Next   : Milliseconds until the head timer expires
+ *
+ * @note     RAM usage: 6 bytes per timer + 1 byte
+ *           (MILLIS_QUEUE_SIZE = 128 on ATmega2560 takes 769 bytes)
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+
+#include "millis_queue.h"
+
+
+/* ============================================================================
+ *                         PRIVATE DEFINITIONS
+ * ============================================================================ */
+#define MILLIS_QUEUE_IDLE       0xFF     /**< Position value of an inactive timer */
+
+
+/* ============================================================================
+ *                         GLOBAL VARIABLES
+ * ============================================================================ */
+static uint32_t millis_QueueExpiry[MILLIS_QUEUE_SIZE];   /**< Absolute expiry time per timer ID */
+static uint8_t  millis_QueueHeap[MILLIS_QUEUE_SIZE];     /**< Min-heap of timer IDs, head expires first */
+static uint8_t  millis_QueuePos[MILLIS_QUEUE_SIZE];      /**< Heap slot per timer ID, MILLIS_QUEUE_IDLE if inactive */
+static uint8_t  millis_QueueCount = 0;                   /**< Number of armed timers */
+
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Check if timer A expires before timer B
+ * @note Signed difference keeps the order correct across the 32-bit
+ *       rollover, as long as all deadlines are within 2^31 ms
+ * ------------------------------------------------------- */
+static inline bool millis_Queue_Before(uint8_t _IdA, uint8_t _IdB)
+{
+    return (int32_t)(millis_QueueExpiry[_IdA] - millis_QueueExpiry[_IdB]) < 0;
+};
+
+/* -------------------------------------------------------
+ * @brief Place a timer ID into a heap slot and update its position
+ * ------------------------------------------------------- */
+static inline void millis_Queue_Place(uint8_t _Slot, uint8_t _Id)
+{
+    millis_QueueHeap[_Slot] = _Id;
+    millis_QueuePos[_Id]    = _Slot;
+};
+
+/* -------------------------------------------------------
+ * @brief Move the ID at a heap slot towards the head until ordered
+ * ------------------------------------------------------- */
+static void millis_Queue_SiftUp(uint8_t _Slot)
+{
+    uint8_t _Id = millis_QueueHeap[_Slot];
+
+    while (_Slot > 0)
+    {
+        uint8_t _Parent = (uint8_t)((_Slot - 1) >> 1);
+
+        if (!millis_Queue_Before(_Id, millis_QueueHeap[_Parent]))
+        {
+            break;
+        }
+        millis_Queue_Place(_Slot, millis_QueueHeap[_Parent]);
+        _Slot = _Parent;
+    }
+    millis_Queue_Place(_Slot, _Id);
+};
+
+/* -------------------------------------------------------
+ * @brief Move the ID at a heap slot away from the head until ordered
+ * @note Child index is computed in 16 bits, slots above 127 would
+ *       overflow an 8-bit 2 * slot + 1
+ * ------------------------------------------------------- */
+static void millis_Queue_SiftDown(uint8_t _Slot)
+{
+    uint8_t _Id = millis_QueueHeap[_Slot];
+
+    while (1)
+    {
+        uint16_t _Child = ((uint16_t)_Slot << 1) + 1;
+
+        if (_Child >= millis_QueueCount)
+        {
+            break;
+        }
+        if (((_Child + 1) < millis_QueueCount) &&
+            millis_Queue_Before(millis_QueueHeap[_Child + 1], millis_QueueHeap[_Child]))
+        {
+            _Child++;                    /**< Pick the child that expires first */
+        }
+        if (!millis_Queue_Before(millis_QueueHeap[_Child], _Id))
+        {
+            break;
+        }
+        millis_Queue_Place(_Slot, millis_QueueHeap[_Child]);
+        _Slot = (uint8_t)_Child;
+    }
+    millis_Queue_Place(_Slot, _Id);
+};
+
+/* -------------------------------------------------------
+ * @brief Remove the ID at a heap slot and restore heap order
+ * @note The last heap entry fills the hole and is sifted both ways,
+ *       only one of the two directions actually moves it
+ * ------------------------------------------------------- */
+static void millis_Queue_Remove(uint8_t _Slot)
+{
+    uint8_t _Id = millis_QueueHeap[_Slot];
+
+    millis_QueuePos[_Id] = MILLIS_QUEUE_IDLE;
+    millis_QueueCount--;
+
+    if (_Slot < millis_QueueCount)
+    {
+        uint8_t _Last = millis_QueueHeap[millis_QueueCount];
+
+        millis_Queue_Place(_Slot, _Last);
+        millis_Queue_SiftDown(_Slot);
+        millis_Queue_SiftUp(millis_QueuePos[_Last]);
+    }
+};
+
+
+/* ============================================================================
+ *                         QUEUE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Clear the timer queue
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Queue_Init(void)
+{
+    for (uint8_t _Id = 0; _Id < MILLIS_QUEUE_SIZE; _Id++)
+    {
+        millis_QueuePos[_Id] = MILLIS_QUEUE_IDLE;
+    }
+    millis_QueueCount = 0;
+};
+
+/* -------------------------------------------------------
+ * @brief Arm a timer to expire Timeout milliseconds from now
+ * @param Id      Timer ID, 0..MILLIS_QUEUE_SIZE-1
+ * @param Timeout Delay until expiry in milliseconds
+ * @retval true if the timer was armed, false if Id is out of range
+ * @note A re-armed timer keeps its slot and is sifted to its new place
+ * ------------------------------------------------------- */
+bool millis_Queue_Start(uint8_t Id, uint32_t Timeout)
+{
+    if (Id >= MILLIS_QUEUE_SIZE)
+    {
+        return false;
+    }
+
+    millis_QueueExpiry[Id] = millis() + Timeout;
+
+    if (millis_QueuePos[Id] == MILLIS_QUEUE_IDLE)
+    {
+        millis_Queue_Place(millis_QueueCount, Id);   /**< New timer goes to the end of the heap */
+        millis_QueueCount++;
+        millis_Queue_SiftUp(millis_QueuePos[Id]);
+    }
+    else
+    {
+        millis_Queue_SiftUp(millis_QueuePos[Id]);    /**< Earlier expiry moves it up ... */
+        millis_Queue_SiftDown(millis_QueuePos[Id]);  /**< ... later expiry moves it down */
+    }
+    return true;
+};
+
+/* -------------------------------------------------------
+ * @brief Stop a timer
+ * @param Id Timer ID, 0..MILLIS_QUEUE_SIZE-1
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Queue_Cancel(uint8_t Id)
+{
+    if ((Id < MILLIS_QUEUE_SIZE) && (millis_QueuePos[Id] != MILLIS_QUEUE_IDLE))
+    {
+        millis_Queue_Remove(millis_QueuePos[Id]);
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief Check if a timer is armed
+ * @param Id Timer ID, 0..MILLIS_QUEUE_SIZE-1
+ * @retval true while the timer is armed
+ * ------------------------------------------------------- */
+bool millis_Queue_Active(uint8_t Id)
+{
+    return (Id < MILLIS_QUEUE_SIZE) && (millis_QueuePos[Id] != MILLIS_QUEUE_IDLE);
+};
+
+/* -------------------------------------------------------
+ * @brief Pop the next expired timer
+ * @retval ID of an expired timer, or MILLIS_QUEUE_NONE
+ * ------------------------------------------------------- */
+uint8_t millis_Queue_Poll(void)
+{
+    uint8_t _Id;
+
+    if (millis_QueueCount == 0)
+    {
+        return MILLIS_QUEUE_NONE;
+    }
+
+    _Id = millis_QueueHeap[0];
+    if ((int32_t)(millis() - millis_QueueExpiry[_Id]) < 0)
+    {
+        return MILLIS_QUEUE_NONE;        /**< Head not due yet, so nothing else is */
+    }
+
+    millis_Queue_Remove(0);
+    return _Id;
+};
+
+/* -------------------------------------------------------
+ * @brief Milliseconds until the head timer expires
+ * @retval Time to the next expiry, 0 if one is due, UINT32_MAX if empty
+ * ------------------------------------------------------- */
+uint32_t millis_Queue_Next(void)
+{
+    int32_t _Remaining;
+
+    if (millis_QueueCount == 0)
+    {
+        return UINT32_MAX;
+    }
+
+    _Remaining = (int32_t)(millis_QueueExpiry[millis_QueueHeap[0]] - millis());
+    return (_Remaining > 0) ? (uint32_t)_Remaining : 0;
+};
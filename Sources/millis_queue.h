@@ -0,0 +1,111 @@
+/**
+ ******************************************************************************
+ * @file     millis_queue.h
+ * @brief    Deadline-sorted software timer queue on top of the millis library
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     This module keeps many one-shot software timers in a binary
+ *           min-heap keyed on absolute expiry time. The main loop only
+ *           looks at the head, so checking for the next due timer is O(1)
+ *           and start/cancel/expire are O(log n). All storage is static.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - millis_Queue_Init   : Clear the queue, all timers inactive
+ *           - millis_Queue_Start  : Arm (or re-arm) a timer for a timeout
+ *           - millis_Queue_Cancel : Stop a timer
+ *           - millis_Queue_Active : Check if a timer is armed
+ *           - millis_Queue_Poll   : Pop the next expired timer
+ *           - millis_Queue_Next   : Milliseconds until the head timer expires
+ *
+ * @note     Configuration (compiler flags, defaults in brackets):
+ *           - MILLIS_QUEUE_SIZE : Number of timers, 1..255 [16]
+ *
+ * @note     Example:
+ *           millis_Queue_Init();
+ *           millis_Queue_Start(RX_TIMEOUT, 50);       // Timer ID 0..MILLIS_QUEUE_SIZE-1
+ *           while (1) {
+ *               uint8_t id;
+ *               while ((id = millis_Queue_Poll()) != MILLIS_QUEUE_NONE) {
+ *                   // Handle expired timer id
+ *               }
+ *           }
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+#ifndef _millis_queue_H_
+#define _millis_queue_H_
+
+#include "millis.h"
+
+
+/* ============================================================================
+ *                         QUEUE CONFIGURATION
+ * ============================================================================ */
+#ifndef MILLIS_QUEUE_SIZE
+    #define MILLIS_QUEUE_SIZE   16       /**< Number of software timers (IDs 0..MILLIS_QUEUE_SIZE-1) */
+#endif
+
+#if (MILLIS_QUEUE_SIZE < 1) || (MILLIS_QUEUE_SIZE > 255)
+    #error "MILLIS_QUEUE_SIZE must be between 1 and 255 (ID 0xFF is reserved)"
+#endif
+
+#define MILLIS_QUEUE_NONE       0xFF     /**< Returned by millis_Queue_Poll when no timer has expired */
+
+
+/* ============================================================================
+ *                         FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Clear the timer queue
+ * @retval None
+ * @note All timers become inactive. Call once before using the queue
+ * ------------------------------------------------------- */
+void millis_Queue_Init(void);
+
+/* -------------------------------------------------------
+ * @brief Arm a timer to expire Timeout milliseconds from now
+ * @param Id      Timer ID, 0..MILLIS_QUEUE_SIZE-1
+ * @param Timeout Delay until expiry in milliseconds, at most 2^31 - 1
+ * @retval true if the timer was armed, false if Id is out of range
+ * @note An already armed timer is moved to its new expiry time
+ * @note O(log n). Main loop only, not safe to call from ISRs
+ * ------------------------------------------------------- */
+bool millis_Queue_Start(uint8_t Id, uint32_t Timeout);
+
+/* -------------------------------------------------------
+ * @brief Stop a timer
+ * @param Id Timer ID, 0..MILLIS_QUEUE_SIZE-1
+ * @retval None
+ * @note Cancelling an inactive timer does nothing. O(log n)
+ * ------------------------------------------------------- */
+void millis_Queue_Cancel(uint8_t Id);
+
+/* -------------------------------------------------------
+ * @brief Check if a timer is armed
+ * @param Id Timer ID, 0..MILLIS_QUEUE_SIZE-1
+ * @retval true while the timer is armed and has not been polled yet
+ * ------------------------------------------------------- */
+bool millis_Queue_Active(uint8_t Id);
+
+/* -------------------------------------------------------
+ * @brief Pop the next expired timer
+ * @retval ID of an expired timer, or MILLIS_QUEUE_NONE
+ * @note Only the head of the heap is checked. Call in a loop until it
+ *       returns MILLIS_QUEUE_NONE to handle all timers due at once.
+ *       Expired timers are returned earliest first
+ * ------------------------------------------------------- */
+uint8_t millis_Queue_Poll(void);
+
+/* -------------------------------------------------------
+ * @brief Milliseconds until the head timer expires
+ * @retval Time to the next expiry, 0 if one is due, UINT32_MAX if empty
+ * @note Suitable as sleep budget for the main loop. O(1)
+ * ------------------------------------------------------- */
+uint32_t millis_Queue_Next(void);
+
+#endif /* _millis_queue_H_ */
@@ -0,0 +1,237 @@
+/**
+ ******************************************************************************
+ * @file     millis_trace.c
+ * @brief    Timestamped event trace in .noinit RAM for post-mortem debugging
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     The ring, its write index and the magic value are not cleared
+ *           by the startup code. millis_Trace_Init decides after a reset
+ *           whether they still describe the last run, everything else
+ *           only reads them. Recording is inline in millis_trace.h.
+ *
+ * @note     Compiles to nothing with MILLIS_PWM, MILLIS_TICKLESS or
+ *           MILLIS_TICK_RATE, so a build that lists all sources still
+ *           links. Including millis_trace.h with one of them and a
+ *           MILLIS_TRACE_SIZE above 0 stops with #error.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - millis_Trace_Init  : Keep the trace of the last run, mark the reset
+ *           - millis_Trace_Clear : Forget all entries
+ *           - millis_Trace_Count : Number of entries held
+ *           - millis_Trace_Get   : Copy one entry, oldest first
+ *           - millis_Trace_Us    : Timestamp of an entry in microseconds
+ *           - millis_Trace_Dump  : Print all entries through a putc callback
+ *
+ * @note     RAM usage: 5 bytes per entry with an 8-bit tick timer, 6 with
+ *           a 16-bit one, plus 4 bytes (MILLIS_TRACE_SIZE = 64 on the
+ *           ATmega328P takes 324 bytes)
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+
+#include "millis.h"
+
+#if !(MILLIS_PWM || MILLIS_TICKLESS || MILLIS_TICK_RATE)
+#include "millis_trace.h"
+
+#if MILLIS_TRACE_SIZE
+
+
+/* ============================================================================
+ *                         GLOBAL VARIABLES
+ * ============================================================================ */
+millis_TraceEntry_T millis_TraceBuf[MILLIS_TRACE_SIZE] __attribute__((section(".noinit")));  /**< Ring of entries */
+volatile uint8_t    millis_TraceHead  __attribute__((section(".noinit")));  /**< Next slot to write */
+volatile uint8_t    millis_TraceFull  __attribute__((section(".noinit")));  /**< 1 once the ring has wrapped */
+static uint16_t     millis_TraceMagic __attribute__((section(".noinit")));  /**< MILLIS_TRACE_MAGIC while the ring is valid */
+
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Print a string through the putc callback
+ * ------------------------------------------------------- */
+static void millis_Trace_PutStr(void (*Putc)(char), const char *_Str)
+{
+    while (*_Str)
+    {
+        Putc(*_Str++);
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief Print an unsigned number in decimal through the putc callback
+ * @param _Width Least number of digits, padded with zeros
+ * ------------------------------------------------------- */
+static void millis_Trace_PutNum(void (*Putc)(char), uint32_t _Value, uint8_t _Width)
+{
+    char    _Digits[10];                 /**< UINT32_MAX has 10 digits */
+    uint8_t _Len = 0;
+
+    do
+    {
+        _Digits[_Len++] = (char)('0' + (_Value % 10));
+        _Value /= 10;
+    } while (_Value || (_Len < _Width));
+
+    while (_Len)
+    {
+        Putc(_Digits[--_Len]);
+    }
+};
+
+
+/* ============================================================================
+ *                         TRACE FUNCTIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Keep the trace of the last run and mark the reset
+ * @param Cause Payload of the MILLIS_TRACE_BOOT entry
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Trace_Init(uint8_t Cause)
+{
+    if ((millis_TraceMagic != MILLIS_TRACE_MAGIC) || (millis_TraceHead >= MILLIS_TRACE_SIZE) || (millis_TraceFull > 1))
+    {
+        millis_Trace_Clear();            /**< Power-up or a trashed index, nothing to keep */
+    }
+    millis_Trace(MILLIS_TRACE_BOOT, Cause);
+};
+
+/* -------------------------------------------------------
+ * @brief Forget all entries
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Trace_Clear(void)
+{
+    uint8_t _Sreg = SREG;
+
+    cli();
+    millis_TraceHead  = 0;
+    millis_TraceFull  = 0;
+    millis_TraceMagic = MILLIS_TRACE_MAGIC;
+    SREG = _Sreg;
+};
+
+/* -------------------------------------------------------
+ * @brief Number of entries held
+ * @retval 0..MILLIS_TRACE_SIZE
+ * ------------------------------------------------------- */
+uint8_t millis_Trace_Count(void)
+{
+    uint8_t _Count;
+    uint8_t _Sreg = SREG;
+
+    cli();
+    _Count = millis_TraceFull ? MILLIS_TRACE_SIZE : millis_TraceHead;
+    SREG = _Sreg;
+    return _Count;
+};
+
+/* -------------------------------------------------------
+ * @brief Copy one entry
+ * @param Index 0 = oldest entry held
+ * @param Entry Receives the entry
+ * @retval true if copied
+ * @note Once the ring has wrapped the oldest entry is the one at the
+ *       write index
+ * ------------------------------------------------------- */
+bool millis_Trace_Get(uint8_t Index, millis_TraceEntry_T *Entry)
+{
+    bool    _Ok = false;
+    uint8_t _Sreg = SREG;
+
+    cli();
+    if (Index < (millis_TraceFull ? MILLIS_TRACE_SIZE : millis_TraceHead))
+    {
+        if (millis_TraceFull)
+        {
+            Index = (uint8_t)(Index + millis_TraceHead) & (MILLIS_TRACE_SIZE - 1);
+        }
+        *Entry = millis_TraceBuf[Index];
+        _Ok = true;
+    }
+    SREG = _Sreg;
+    return _Ok;
+};
+
+/* -------------------------------------------------------
+ * @brief Timestamp of an entry in microseconds
+ * @param Entry Entry copied with millis_Trace_Get
+ * @retval Microseconds modulo 65536000
+ * @note Converted like a millis_Stamp_T. With MILLIS_CALIBRATE the
+ *       count is scaled with the period in effect now, the difference
+ *       is a few ppm of one tick
+ * ------------------------------------------------------- */
+uint32_t millis_Trace_Us(const millis_TraceEntry_T *Entry)
+{
+    millis_Stamp_T _Stamp;
+
+    _Stamp.Millis = Entry->Millis;
+    _Stamp.Count  = Entry->Count;
+    return millis_Stamp_Us(&_Stamp);
+};
+
+/* -------------------------------------------------------
+ * @brief Print all entries, oldest first, through a putc callback
+ * @param Putc Function writing one character
+ * @retval None
+ * @note System_millis restarts at a reset, so no time since the entry
+ *       before is printed for a reset marker and the entry after it
+ * ------------------------------------------------------- */
+void millis_Trace_Dump(void (*Putc)(char))
+{
+    millis_TraceEntry_T _Entry;
+    uint8_t  _Count = millis_Trace_Count();
+    uint32_t _Last  = 0;
+    bool     _First = true;
+
+    for (uint8_t _Index = 0; _Index < _Count; _Index++)
+    {
+        uint32_t _Us;
+
+        if (!millis_Trace_Get(_Index, &_Entry))
+        {
+            break;                       /**< Cleared while dumping */
+        }
+
+        if (_Entry.Id == MILLIS_TRACE_BOOT)
+        {
+            millis_Trace_PutStr(Putc, "BOOT D");
+            millis_Trace_PutNum(Putc, _Entry.Data, 1);
+            millis_Trace_PutStr(Putc, "\r\n");
+            _First = true;
+            continue;
+        }
+
+        _Us = millis_Trace_Us(&_Entry);
+        Putc('E');
+        millis_Trace_PutNum(Putc, _Entry.Id, 1);
+        millis_Trace_PutStr(Putc, " D");
+        millis_Trace_PutNum(Putc, _Entry.Data, 1);
+        millis_Trace_PutStr(Putc, " t=");
+        millis_Trace_PutNum(Putc, _Us / 1000UL, 1);
+        Putc('.');
+        millis_Trace_PutNum(Putc, _Us % 1000UL, 3);
+        if (!_First)
+        {
+            uint32_t _Delta = (_Us >= _Last) ? (_Us - _Last) : (_Us + 65536000UL - _Last);  /**< Across the 16-bit ms wrap */
+
+            millis_Trace_PutStr(Putc, " +");
+            millis_Trace_PutNum(Putc, _Delta, 1);
+        }
+        millis_Trace_PutStr(Putc, "\r\n");
+        _Last  = _Us;
+        _First = false;
+    }
+};
+
+#endif /* MILLIS_TRACE_SIZE */
+#endif /* !(MILLIS_PWM || MILLIS_TICKLESS || MILLIS_TICK_RATE) */
@@ -0,0 +1,199 @@
+/**
+ ******************************************************************************
+ * @file     millis_trace.h
+ * @brief    Timestamped event trace in .noinit RAM for post-mortem debugging
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     millis_Trace(Id, Data) stores a raw timestamp (low 16 bits of
+ *           System_millis and the tick timer count), an event ID and one
+ *           payload byte in a ring. Nothing is converted while recording,
+ *           the entry is 5 bytes with an 8-bit tick timer and 6 bytes with
+ *           a 16-bit one. The ring sits in .noinit, so after a watchdog or
+ *           brown-out reset the events leading up to it are still there
+ *           and can be dumped over the UART.
+ *
+ * @note     FUNCTION SUMMARY:
+ *           - millis_Trace       : Record an event (inline, ISR safe)
+ *           - millis_Trace_Init  : Keep the trace of the last run, mark the reset
+ *           - millis_Trace_Clear : Forget all entries
+ *           - millis_Trace_Count : Number of entries held
+ *           - millis_Trace_Get   : Copy one entry, oldest first
+ *           - millis_Trace_Us    : Timestamp of an entry in microseconds
+ *           - millis_Trace_Dump  : Print all entries through a putc callback
+ *
+ * @note     Configuration (compiler flags, defaults in brackets):
+ *           - MILLIS_TRACE_SIZE : Entries, power of two 2..128,
+ *                                 0 = trace calls compile to nothing [0]
+ *
+ * @note     Example (built with -DMILLIS_TRACE_SIZE=64):
+ *           millis_Init();
+ *           millis_Trace_Init(millis_Watchdog_ResetFlags());  // Reset cause, MCUSR without MILLIS_WATCHDOG
+ *           MCUSR = 0;
+ *           if (button_Held()) millis_Trace_Dump(uart_Putc);
+ *           ...
+ *           ISR(USART_RX_vect) { millis_Trace(EV_RX, UDR0); }
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+#ifndef _millis_trace_H_
+#define _millis_trace_H_
+
+#include "millis.h"
+
+
+/* ============================================================================
+ *                         TRACE CONFIGURATION
+ * ============================================================================ */
+#ifndef MILLIS_TRACE_SIZE
+    #define MILLIS_TRACE_SIZE   0        /**< Entries in the ring, 0 = trace compiled out */
+#endif
+
+#if MILLIS_TRACE_SIZE && ((MILLIS_TRACE_SIZE < 2) || (MILLIS_TRACE_SIZE > 128) || (MILLIS_TRACE_SIZE & (MILLIS_TRACE_SIZE - 1)))
+    #error "MILLIS_TRACE_SIZE must be 0 or a power of two between 2 and 128"
+#endif
+
+#if MILLIS_TRACE_SIZE && (MILLIS_PWM || MILLIS_TICKLESS || MILLIS_TICK_RATE)
+    #error "millis_trace.h needs a fixed CTC tick - disable MILLIS_PWM, MILLIS_TICKLESS and MILLIS_TICK_RATE, or use millis_Stamp"
+#endif
+
+#define MILLIS_TRACE_BOOT       0xFF     /**< Event ID of the reset marker, reserved */
+#define MILLIS_TRACE_MAGIC      0x7ACEU  /**< Marks a valid ring in .noinit */
+
+
+/* ============================================================================
+ *                         TYPE DEFINITIONS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief One trace entry, raw as recorded
+ * @note Millis wraps every 65.536s, the dump shows the time between
+ *       entries, so only gaps longer than that come out short
+ * ------------------------------------------------------- */
+typedef struct
+{
+    uint16_t       Millis;    /**< Low 16 bits of System_millis including a pending tick */
+    millis_Count_T Count;     /**< Timer counts into the running tick */
+    uint8_t        Id;        /**< Event ID, MILLIS_TRACE_BOOT marks a reset */
+    uint8_t        Data;      /**< Payload */
+} millis_TraceEntry_T;
+
+
+#if MILLIS_TRACE_SIZE
+/* ============================================================================
+ *                         GLOBAL VARIABLES
+ * ============================================================================
+ *  Written by millis_Trace below, kept in .noinit by millis_trace.c.
+ *  Do not access directly.
+ * ============================================================================ */
+extern millis_TraceEntry_T millis_TraceBuf[MILLIS_TRACE_SIZE];
+extern volatile uint8_t    millis_TraceHead;   /**< Next slot to write */
+extern volatile uint8_t    millis_TraceFull;   /**< 1 once the ring has wrapped */
+
+
+/* ============================================================================
+ *                         FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Keep the trace of the last run and mark the reset
+ * @param Cause Payload of the MILLIS_TRACE_BOOT entry, e.g. millis_Watchdog_ResetFlags()
+ * @retval None
+ * @note Call once at startup. After power-up .noinit holds random data,
+ *       the magic value and the index range reject it and the ring
+ *       starts empty
+ * ------------------------------------------------------- */
+void millis_Trace_Init(uint8_t Cause);
+
+/* -------------------------------------------------------
+ * @brief Forget all entries
+ * @retval None
+ * ------------------------------------------------------- */
+void millis_Trace_Clear(void);
+
+/* -------------------------------------------------------
+ * @brief Number of entries held
+ * @retval 0..MILLIS_TRACE_SIZE
+ * ------------------------------------------------------- */
+uint8_t millis_Trace_Count(void);
+
+/* -------------------------------------------------------
+ * @brief Copy one entry
+ * @param Index 0 = oldest entry held
+ * @param Entry Receives the entry
+ * @retval true if copied, false if Index is not below millis_Trace_Count()
+ * ------------------------------------------------------- */
+bool millis_Trace_Get(uint8_t Index, millis_TraceEntry_T *Entry);
+
+/* -------------------------------------------------------
+ * @brief Timestamp of an entry in microseconds
+ * @param Entry Entry copied with millis_Trace_Get
+ * @retval Microseconds modulo 65536000 (the 16-bit millisecond wrap)
+ * ------------------------------------------------------- */
+uint32_t millis_Trace_Us(const millis_TraceEntry_T *Entry);
+
+/* -------------------------------------------------------
+ * @brief Print all entries, oldest first, through a putc callback
+ * @param Putc Function writing one character, e.g. a blocking UART send
+ * @retval None
+ * @note One line per entry: "E<id> D<data> t=<ms>.<us> +<us since the
+ *       entry before>" and CR LF, a reset marker prints as
+ *       "BOOT D<cause>". No printf, so no stdio code is linked in
+ * ------------------------------------------------------- */
+void millis_Trace_Dump(void (*Putc)(char));
+
+/* -------------------------------------------------------
+ * @brief Record an event
+ * @param Id   Event ID, 0..254
+ * @param Data Payload
+ * @retval None
+ * @note Only the raw counter pair is read, with interrupts disabled for
+ *       about 15 cycles, the whole call inlines to about 30 cycles.
+ *       Safe in ISRs, a compare match pending at the read is counted
+ *       like in millis_Stamp
+ * ------------------------------------------------------- */
+static inline void millis_Trace(uint8_t Id, uint8_t Data)
+{
+    millis_TraceEntry_T *_Entry;
+    uint16_t _Millis;
+    millis_Count_T _Count;
+    uint8_t  _Head;
+    uint8_t  _Sreg = SREG;
+
+    cli();
+    _Millis = (uint16_t)System_millis;
+    _Count  = MILLIS_TCNT;
+    if (bit_is_set(MILLIS_TIFR, MILLIS_OCF) && (_Count < MILLIS_OCR))
+    {
+        _Millis += MILLIS_MS_PER_TICK;   /**< Compare match pending and counter already wrapped */
+    }
+    _Head = millis_TraceHead;
+    millis_TraceHead = (uint8_t)(_Head + 1) & (MILLIS_TRACE_SIZE - 1);
+    if (_Head == (MILLIS_TRACE_SIZE - 1))
+    {
+        millis_TraceFull = 1;
+    }
+    SREG = _Sreg;
+
+    _Entry = &millis_TraceBuf[_Head];    /**< Slot is reserved, filled with interrupts enabled */
+    _Entry->Millis = _Millis;
+    _Entry->Count  = _Count;
+    _Entry->Id     = Id;
+    _Entry->Data   = Data;
+};
+
+#else
+/* ===== MILLIS_TRACE_SIZE = 0: trace points stay in the code, arguments are still evaluated ===== */
+#define millis_Trace(Id, Data)          ((void)(Id), (void)(Data))
+#define millis_Trace_Init(Cause)        ((void)(Cause))
+#define millis_Trace_Clear()            ((void)0)
+#define millis_Trace_Count()            ((uint8_t)0)
+#define millis_Trace_Get(Index, Entry)  ((void)(Index), (void)(Entry), false)
+#define millis_Trace_Us(Entry)          ((void)(Entry), 0UL)
+#define millis_Trace_Dump(Putc)         ((void)(Putc))
+#endif /* MILLIS_TRACE_SIZE */
+
+#endif /* _millis_trace_H_ */
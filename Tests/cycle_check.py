@@ -0,0 +1,329 @@
+#!/usr/bin/env python3
+"""
+******************************************************************************
+@file     cycle_check.py
+@brief    Cycle-count regression check of the tick path from avr-gcc output
+
+@author   Hossein Bagheri
+@github   https://github.com/aKaReZa75
+
+@note     Builds millis.c and millis_queue.c with avr-gcc at -Os and -O2,
+          disassembles the objects with avr-objdump and times the paths
+          through the tick ISR, millis(), micros() and the scheduler and
+          queue calls. The counts are compared with
+          Tests/cycle_baseline.txt, the check fails when one of them grew
+          or has no baseline entry.
+
+          Run from the repository root, with the directory of aKaReZa.h:
+
+          python3 Tests/cycle_check.py -I path/to/aKaReZa          # check
+          python3 Tests/cycle_check.py -I path/to/aKaReZa --update # record
+
+@note     Two counts per function, in CPU cycles from the first
+          instruction to the RET / RETI:
+          - min: the shortest path, e.g. a tick with nothing else to do
+          - max: the longest path that takes no backward branch
+          Taken branches cost 2 cycles and not taken 1, skips 1, 2 or 3 by
+          the size of the skipped instruction. A loop is left at its
+          first test, so loop bodies reached only through a backward
+          branch are not part of max. A call counts as the CALL / RCALL
+          only, the callee (e.g. a libgcc division) is not followed, and
+          a tail jump out of the function ends the path.
+
+@note     The ISR counts include the prologue, epilogue and RETI. The 4
+          cycles of interrupt response and the 3 of the vector jump come
+          on top.
+
+@note     The cycle table is the classic AVR one with a 2-byte PC
+          (ATmega328P, the default -mmcu). Devices with a 3-byte PC,
+          AVRxt and xmega cores time some instructions differently, so
+          keep one baseline file per device (--baseline).
+
+@note     millis() is inline, it is measured through a wrapper function
+          that returns it, so its count includes a RET (4 cycles).
+
+@note     Exit code: 0 = no count grew, 1 = a count grew or a function
+          has no baseline entry (record it with --update)
+
+@note     For detailed documentation with examples, visit:
+          https://github.com/aKaReZa75/AVR_millis
+******************************************************************************
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+
+# ============================================================================
+#                          CONFIGURATION
+# ============================================================================
+ROOT     = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCES  = os.path.join(ROOT, "Sources")
+BASELINE = os.path.join(ROOT, "Tests", "cycle_baseline.txt")
+OPTS     = ("Os", "O2")
+
+# Functions per object, the tick ISR is found as the only __vector_N of millis.o
+FUNCTIONS = {
+    "millis.c":       ("__vector", "micros", "millis_Stamp", "millis_Scheduler"),
+    "millis_queue.c": ("millis_Queue_Start", "millis_Queue_Poll", "millis_Queue_Cancel"),
+    "wrap.c":         ("cycle_millis",),
+}
+
+# millis() is a static inline in millis.h, give it a symbol of its own
+WRAPPER = '#include "millis.h"\nuint32_t cycle_millis(void)\n{\n    return millis();\n}\n'
+
+# Cycles of each mnemonic on a classic AVR with a 2-byte PC, 1 if not listed.
+# Branches and skips are timed in path_counts, these are their not-taken cycles
+CYCLES = {
+    "adiw": 2, "sbiw": 2,
+    "mul": 2, "muls": 2, "mulsu": 2, "fmul": 2, "fmuls": 2, "fmulsu": 2,
+    "ld": 2, "ldd": 2, "lds": 2, "st": 2, "std": 2, "sts": 2,
+    "push": 2, "pop": 2, "cbi": 2, "sbi": 2,
+    "lpm": 3, "elpm": 3,
+    "rjmp": 2, "ijmp": 2, "eijmp": 2, "jmp": 3,
+    "rcall": 3, "icall": 3, "eicall": 4, "call": 4,
+    "ret": 4, "reti": 4,
+}
+
+SKIPS = ("cpse", "sbrc", "sbrs", "sbic", "sbis")   # 1 cycle, +1 or +2 when skipping
+JUMPS = ("rjmp", "jmp")
+EXITS = ("ret", "reti", "ijmp", "eijmp")           # Indirect jumps leave the function too
+
+
+# ============================================================================
+#                          DISASSEMBLY
+# ============================================================================
+HEADER_RE = re.compile(r"^[0-9a-f]+ <([^>]+)>:$")
+INSN_RE   = re.compile(r"^\s*([0-9a-f]+):\s+((?:[0-9a-f]{2} )+)\s*(\S+)\s*([^;]*)")
+RELOC_RE  = re.compile(r"^\s*([0-9a-f]+):\s+R_AVR_\S+\s+(\S+)")
+LOCAL_RE  = re.compile(r"^\.text(?:\.\S*?)?(?:\+0x([0-9a-f]+))?$")
+REL_RE    = re.compile(r"^\.([+-]\d+)$")
+
+
+def parse_functions(text):
+    """
+    @brief  Split an avr-objdump -d -r listing into functions
+    @param  text Output of avr-objdump -d -r
+    @retval {name: [(address, words, mnemonic, operands, reloc)]}, reloc is
+            the symbol of a relocation at the address or None
+    """
+    result = {}
+    name = None
+
+    for line in text.splitlines():
+        header = HEADER_RE.match(line.strip())
+        if header:
+            name = header.group(1)
+            result[name] = []
+            continue
+        reloc = RELOC_RE.match(line)
+        if reloc and name and result[name]:
+            address = int(reloc.group(1), 16)
+            for index, insn in enumerate(result[name]):
+                if insn[0] == address:
+                    result[name][index] = insn[:4] + (reloc.group(2),)
+            continue
+        insn = INSN_RE.match(line)
+        if insn and name:
+            words = len(insn.group(2).split()) // 2
+            result[name].append((int(insn.group(1), 16), words, insn.group(3).lower(),
+                                 insn.group(4).strip(), None))
+    return result
+
+
+def branch_target(insn):
+    """
+    @brief  Target of a jump or branch
+    @param  insn Instruction tuple of parse_functions
+    @retval Byte address in the section, None if it leaves the object
+            (a relocation against another symbol, e.g. a tail call)
+    """
+    address, _, _, operands, reloc = insn
+    target = operands.split(",")[-1].strip()
+
+    if reloc is not None:
+        local = LOCAL_RE.match(reloc)
+        if not local:
+            return None
+        return int(local.group(1) or "0", 16)
+    relative = REL_RE.match(target)
+    if relative:
+        return address + 2 + int(relative.group(1))
+    try:
+        return int(target, 0)
+    except ValueError:
+        return None
+
+
+def path_counts(insns):
+    """
+    @brief  Shortest and longest path from the entry to an exit
+    @param  insns Instructions of one function, in address order
+    @retval (min, max) cycles, (None, None) if no exit is reachable
+    @note   Backward branches and jumps count as not taken, that makes the
+            control flow acyclic and the counts are found in one pass from
+            the last instruction to the first
+    """
+    INF = float("inf")
+    at = {insn[0]: index for index, insn in enumerate(insns)}
+    lo = [INF] * (len(insns) + 1)        # Index len(insns) = fell off the end, no exit
+    hi = [-INF] * (len(insns) + 1)
+
+    def follow(index, cycles, low, high):
+        """Combine one successor into the running min / max"""
+        return min(low, cycles + lo[index]), max(high, cycles + hi[index])
+
+    for index in range(len(insns) - 1, -1, -1):
+        address, words, mnemonic, _, _ = insns[index]
+        cycles = CYCLES.get(mnemonic, 1)
+        after = index + 1
+        low, high = INF, -INF
+
+        if mnemonic in EXITS:
+            low, high = cycles, cycles
+        elif mnemonic in JUMPS:
+            target = branch_target(insns[index])
+            if (target is None) or (target not in at):
+                low, high = cycles, cycles       # Tail jump out of the function
+            elif target > address:
+                low, high = follow(at[target], cycles, low, high)
+        elif mnemonic.startswith("br"):
+            target = branch_target(insns[index])
+            low, high = follow(after, 1, low, high)
+            if (target is not None) and (target in at) and (target > address):
+                low, high = follow(at[target], 2, low, high)
+        elif mnemonic in SKIPS:
+            low, high = follow(after, 1, low, high)
+            if after < len(insns):
+                low, high = follow(after + 1, 1 + insns[after][1], low, high)
+        else:
+            low, high = follow(after, cycles, low, high)
+        lo[index], hi[index] = low, high
+
+    if not insns or lo[0] == INF:
+        return None, None
+    return int(lo[0]), int(hi[0])
+
+
+def measure(opt, mmcu, fcpu, includes, cflags):
+    """
+    @brief  Build the objects at one optimization level and time them
+    @retval {function: (min, max, words)}
+    """
+    measured = {}
+
+    with tempfile.TemporaryDirectory() as tmp:
+        with open(os.path.join(tmp, "wrap.c"), "w") as wrap:
+            wrap.write(WRAPPER)
+
+        for source, functions in FUNCTIONS.items():
+            path = os.path.join(tmp, source) if source == "wrap.c" else os.path.join(SOURCES, source)
+            obj = os.path.join(tmp, source + ".o")
+            cmd = ["avr-gcc", "-mmcu=" + mmcu, "-DF_CPU=" + fcpu, "-" + opt, "-std=gnu99",
+                   "-I" + SOURCES] + ["-I" + inc for inc in includes] + cflags + ["-c", path, "-o", obj]
+            subprocess.run(cmd, check=True)
+            listing = subprocess.run(["avr-objdump", "-d", "-r", obj], check=True,
+                                     stdout=subprocess.PIPE, universal_newlines=True).stdout
+            parsed = parse_functions(listing)
+
+            for function in functions:
+                if function == "__vector":
+                    vectors = sorted(name for name in parsed if name.startswith("__vector_"))
+                    if len(vectors) != 1:
+                        sys.exit("cycle_check: expected one tick vector in millis.o, found %s" % vectors)
+                    function = vectors[0]
+                if function not in parsed:
+                    sys.exit("cycle_check: %s not found in %s at -%s" % (function, source, opt))
+                low, high = path_counts(parsed[function])
+                if low is None:
+                    sys.exit("cycle_check: no path to a return in %s at -%s" % (function, opt))
+                measured[function] = (low, high, sum(insn[1] for insn in parsed[function]))
+    return measured
+
+
+# ============================================================================
+#                          BASELINE
+# ============================================================================
+def load_baseline(path):
+    """
+    @brief  Read the baseline file
+    @retval {(opt, function): (min, max, words)}
+    """
+    baseline = {}
+
+    if not os.path.exists(path):
+        return baseline
+    with open(path) as file:
+        for line in file:
+            fields = line.split("#", 1)[0].split()
+            if len(fields) == 5:
+                baseline[(fields[0], fields[1])] = tuple(int(field) for field in fields[2:])
+    return baseline
+
+
+def save_baseline(path, results, mmcu, fcpu, cflags):
+    """
+    @brief  Write the measured counts as the new baseline
+    """
+    with open(path, "w") as file:
+        file.write("# Cycle baseline of Tests/cycle_check.py, -mmcu=%s -DF_CPU=%s %s\n" % (mmcu, fcpu, " ".join(cflags)))
+        file.write("# Path cycles entry to RET/RETI: min = shortest, max = longest without a backward branch\n")
+        file.write("# opt  function                 min   max words\n")
+        for (opt, function), (low, high, words) in sorted(results.items()):
+            file.write("%-4s %-22s %5d %5d %5d\n" % (opt, function, low, high, words))
+
+
+# ============================================================================
+#                          MAIN
+# ============================================================================
+def main():
+    parser = argparse.ArgumentParser(description="Cycle-count regression check of the millis tick path")
+    parser.add_argument("-I", dest="includes", action="append", default=[], help="include directory, e.g. of aKaReZa.h")
+    parser.add_argument("-D", dest="defines", action="append", default=[], help="extra define, e.g. MILLIS_UPTIME=1")
+    parser.add_argument("--mmcu", default="atmega328p")
+    parser.add_argument("--fcpu", default="16000000UL")
+    parser.add_argument("--baseline", default=BASELINE)
+    parser.add_argument("--update", action="store_true", help="record the measured counts as the baseline")
+    args = parser.parse_args()
+
+    cflags = ["-D" + define for define in args.defines]
+    results = {}
+    for opt in OPTS:
+        for function, count in measure(opt, args.mmcu, args.fcpu, args.includes, cflags).items():
+            results[(opt, function)] = count
+
+    if args.update:
+        save_baseline(args.baseline, results, args.mmcu, args.fcpu, cflags)
+        print("baseline written to %s" % os.path.relpath(args.baseline, ROOT))
+        return 0
+
+    baseline = load_baseline(args.baseline)
+    failed = False
+
+    print("%-4s %-22s %5s %5s %9s %5s  %s" % ("opt", "function", "min", "max", "base", "words", "status"))
+    for key in sorted(results):
+        low, high, words = results[key]
+        if key not in baseline:
+            status, base = "NO BASELINE, run --update", "-"
+            failed = True
+        else:
+            base_low, base_high = baseline[key][0], baseline[key][1]
+            base = "%d/%d" % (base_low, base_high)
+            if (low > base_low) or (high > base_high):
+                status = "GREW %+d/%+d" % (low - base_low, high - base_high)
+                failed = True
+            elif (low < base_low) or (high < base_high):
+                status = "shrank %+d/%+d, run --update" % (low - base_low, high - base_high)
+            else:
+                status = "ok"
+        print("%-4s %-22s %5d %5d %9s %5d  %s" % (key[0], key[1], low, high, base, words, status))
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,691 @@
+/**
+ ******************************************************************************
+ * @file     host_bench.c
+ * @brief    Host benchmark and wraparound checks for the millis library
+ *
+ * @author   Hossein Bagheri
+ * @github   https://github.com/aKaReZa75
+ *
+ * @note     Runs on the PC against the simulated Timer0 of millis_host.c.
+ *           Build and run from the repository root:
+ *
+ *           gcc -std=gnu99 -O2 -DMILLIS_HOST=1 -DF_CPU=16000000UL -DMILLIS_QUEUE_SIZE=255 -ISources Sources/millis*.c Tests/host_bench.c -o host_bench && ./host_bench
+ *
+ *           and once more for each tick mode, with the extra flags:
+ *           - MILLIS_FRACTIONAL : -DMILLIS_FRACTIONAL=1 -DMILLIS_PRESCALER=1024 (15.625 counts per ms)
+ *           - MILLIS_TICKLESS   : -DMILLIS_TICKLESS=1 -DMILLIS_FRACTIONAL=1 -DMILLIS_PRESCALER=1024
+ *           - MILLIS_CALIBRATE  : -DMILLIS_CALIBRATE=1
+ *           - MILLIS_TICK_RATE  : -DMILLIS_TICK_RATE=1
+ *
+ * @note     Checks (the exit code is 1 if any of them fails):
+ *           - millis() and micros() against the simulated CPU cycles
+ *             over 20s of uneven steps, monotonic, no drift
+ *           - MILLIS_TICKLESS: millis_Delay sleeps skip ticks and catch
+ *             up to the simulated time
+ *           - MILLIS_TICK_RATE: the same on every switch between
+ *             10kHz, 1kHz, 2kHz and 100Hz, at a random tick phase
+ *           - MILLIS_CALIBRATE: edges of a reference 500ppm fast,
+ *             300ppm slow and 2000ppm fast trim micros() to its rate
+ *           - millis(), micros(), millis_T, millis16_T and millis8_T
+ *             across the 2^32 wrap of System_millis
+ *           - millis_Queue timers armed before the wrap and due after
+ *             it, expiry time and order
+ *           - millis_Scheduler runs every task once per interval
+ *           - millis_Queue returns every timer once, earliest first
+ *
+ * @note     Benchmarks (host nanoseconds, printed only, never fail):
+ *           - millis_Scheduler pass with 1, 8 and 32 tasks, idle and all due
+ *           - millis_Queue_Start / _Poll / _Cancel with 10 to 255 timers.
+ *             The queue holds at most 255 timers (ID 0xFF is
+ *             MILLIS_QUEUE_NONE), so 1000 can not be measured
+ *
+ * @note     Host times compare one version of the code with the next on
+ *           the same PC, they are not AVR cycles. The O(log n) growth of
+ *           the queue shows up the same way on the target
+ *
+ * @note     For detailed documentation with examples, visit:
+ *           https://github.com/aKaReZa75/AVR_millis
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "millis.h"
+#include "millis_queue.h"
+
+#if !MILLIS_HOST
+    #error "host_bench.c is a host program - build it with -DMILLIS_HOST=1"
+#endif
+
+#if (MILLIS_QUEUE_SIZE < 255) || (MILLIS_TICK_HZ != 1000) || ((F_CPU) % 1000UL)
+    #error "host_bench.c expects MILLIS_QUEUE_SIZE=255, a 1ms start tick and a whole number of CPU cycles per ms"
+#endif
+
+
+/* ============================================================================
+ *                         CONFIGURATION
+ * ============================================================================ */
+#define BENCH_SCHED_PASSES      20000UL  /**< Scheduler passes per measurement */
+#define BENCH_QUEUE_ROUNDS      200UL    /**< Fill / drain rounds per queue size */
+#define BENCH_QUEUE_SPREAD      10000UL  /**< Timeouts are drawn from 1..BENCH_QUEUE_SPREAD ms */
+#define BENCH_COUNT_US          ((MILLIS_US_SCALE >> MILLIS_US_SHIFT) + 1)   /**< One timer count in whole microseconds, rounded up */
+#define BENCH_TOL_US            ((2 * BENCH_COUNT_US) + 1)   /**< micros() error allowed against the cycles, a count at each end */
+#define BENCH_STEP_MAX          2048UL   /**< Timebase checks advance 1..BENCH_STEP_MAX cycles per step */
+#define BENCH_RATE_SETTLE_US    50000UL  /**< Time after a tick rate switch with the coarser count allowed */
+#define BENCH_CAL_EDGE_US       10000000UL   /**< Reference edge interval of the calibration check */
+#define BENCH_CAL_PPM           ((int32_t)(((2 * BENCH_COUNT_US) * 1000000UL) / BENCH_CAL_EDGE_US) + 1)  /**< Trim error allowed, two counts per edge interval */
+
+
+/* ============================================================================
+ *                         GLOBAL VARIABLES
+ * ============================================================================ */
+static uint32_t bench_Failures = 0;      /**< Failed checks */
+static uint32_t bench_Seed     = 12345;  /**< LCG state, fixed so every run is the same */
+static uint32_t bench_Calls    = 0;      /**< Scheduler callback count */
+
+/* -------------------------------------------------------
+ * @brief Reference point of the timebase checks, see bench_Mark
+ * ------------------------------------------------------- */
+static struct
+{
+    uint64_t Cycles;                     /**< millis_Host_Cycles() at the mark */
+    uint32_t Us;                         /**< micros() at the mark */
+    int32_t  Ppm;                        /**< Expected rate of micros() against the cycles */
+    uint32_t LastUs;                     /**< micros() at the last step, for the monotonic check */
+    uint32_t LastMs;                     /**< millis() at the last step */
+} bench_Ref;
+
+
+/* ============================================================================
+ *                         HELPERS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Record a check
+ * ------------------------------------------------------- */
+#define BENCH_CHECK(_Cond)                                                  \
+    do                                                                      \
+    {                                                                       \
+        if (!(_Cond))                                                       \
+        {                                                                   \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #_Cond);         \
+            bench_Failures++;                                               \
+        }                                                                   \
+    } while (0)
+
+/* -------------------------------------------------------
+ * @brief Host monotonic time
+ * @retval Nanoseconds
+ * ------------------------------------------------------- */
+static uint64_t bench_Ns(void)
+{
+    struct timespec _Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &_Ts);
+    return ((uint64_t)_Ts.tv_sec * 1000000000ULL) + (uint64_t)_Ts.tv_nsec;
+};
+
+/* -------------------------------------------------------
+ * @brief Pseudo-random number, the same sequence on every run
+ * @retval 0..32767
+ * ------------------------------------------------------- */
+static uint32_t bench_Rand(void)
+{
+    bench_Seed = (bench_Seed * 1103515245UL) + 12345UL;
+    return (bench_Seed >> 16) & 0x7FFF;
+};
+
+/* -------------------------------------------------------
+ * @brief Restart the simulation at a given counter value
+ * @param _Millis New System_millis
+ * @note The simulated timer restarts too, so the next tick is 1ms away
+ * ------------------------------------------------------- */
+static void bench_Restart(uint32_t _Millis)
+{
+    millis_Init();
+    sei();
+    System_millis = _Millis;
+};
+
+/* -------------------------------------------------------
+ * @brief Scheduler task callback
+ * ------------------------------------------------------- */
+static void bench_Task(void)
+{
+    bench_Calls++;
+};
+
+
+/* ============================================================================
+ *                         WRAPAROUND CHECKS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief millis() and micros() across the 2^32 wrap
+ * ------------------------------------------------------- */
+static void bench_WrapCounter(void)
+{
+    uint32_t _Before;
+    uint32_t _After;
+
+    bench_Restart(UINT32_MAX - 5);
+    millis_Host_RunUs(10000);
+    BENCH_CHECK(millis() == 4);          /**< 10 ticks later, past the wrap */
+
+    /* micros() wraps on its own at 2^32 us, close to System_millis = 4294967 */
+    bench_Restart(4294967UL - 3);
+    _Before = micros();
+    for (uint32_t _Step = 0; _Step < 100; _Step++)
+    {
+        millis_Host_RunUs(100);
+        _After = micros();
+        BENCH_CHECK((uint32_t)(_After - _Before) <= (100 + (2 * BENCH_COUNT_US)));   /**< 100us, one count of error at each end, modulo 2^32 */
+        _Before = _After;
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief millis_T in both re-arm modes across the 2^32 wrap
+ * ------------------------------------------------------- */
+static void bench_WrapTimer(void)
+{
+    millis_T _Delay = {.Previous = UINT32_MAX - 5, .Interval = 8};
+    millis_T _Rate  = {.Previous = UINT32_MAX - 5, .Interval = 8};
+    uint32_t _Fired = 0;
+
+    bench_Restart(UINT32_MAX - 5);
+    for (uint32_t _Ms = 0; _Ms < 40; _Ms++)
+    {
+        bool _DelayDue = millis_Expired(&_Delay, MILLIS_FIXED_DELAY);
+        bool _RateDue  = millis_Expired(&_Rate, MILLIS_FIXED_RATE);
+
+        BENCH_CHECK(_DelayDue == _RateDue);  /**< Checked every ms, the modes agree */
+        if (_RateDue)
+        {
+            _Fired++;
+            BENCH_CHECK(_Rate.Previous == (uint32_t)(UINT32_MAX - 5 + (8 * _Fired)));
+        }
+        millis_Host_RunUs(1000);
+    }
+    BENCH_CHECK(_Fired == 4);            /**< Due at 2, 10, 18, 26 after the wrap */
+};
+
+/* -------------------------------------------------------
+ * @brief millis16_T and millis8_T across the 2^32 wrap
+ * ------------------------------------------------------- */
+static void bench_WrapCompact(void)
+{
+    millis16_T _T16;
+    millis8_T  _T8;
+    uint32_t   _Fired16 = 0;
+    uint32_t   _Fired8  = 0;
+
+    bench_Restart(UINT32_MAX - 100);
+    _T16.Previous = millis16();
+    _T16.Interval = 40;
+    _T8.Previous  = millis8();
+    _T8.Interval  = MILLIS8_MS(64);
+    for (uint32_t _Ms = 0; _Ms < 200; _Ms++)
+    {
+        millis_Host_RunUs(1000);
+        if (millis16_Expired(&_T16))
+        {
+            _Fired16++;
+            BENCH_CHECK((uint32_t)(millis() - (UINT32_MAX - 100)) == (40 * _Fired16));
+        }
+        if (millis8_Expired(&_T8))
+        {
+            _Fired8++;
+        }
+    }
+    BENCH_CHECK(_Fired16 == 5);
+    BENCH_CHECK((_Fired8 == 3) || (_Fired8 == 4));    /**< 200ms / 64ms, the first one may come a unit early */
+};
+
+/* -------------------------------------------------------
+ * @brief Queue timers armed before the 2^32 wrap and due after it
+ * ------------------------------------------------------- */
+static void bench_WrapQueue(void)
+{
+    uint32_t _Start = UINT32_MAX - 500;
+    uint32_t _Due[10];
+    uint8_t  _Seen  = 0;
+    uint32_t _Last  = 0;
+
+    bench_Restart(_Start);
+    millis_Queue_Init();
+    for (uint8_t _Id = 0; _Id < 10; _Id++)
+    {
+        _Due[_Id] = (uint32_t)(1000 - (100 * _Id));   /**< 1000..100ms, most of them past the wrap */
+        BENCH_CHECK(millis_Queue_Start(_Id, _Due[_Id]));
+    }
+
+    for (uint32_t _Ms = 0; _Ms <= 1000; _Ms++)
+    {
+        uint8_t _Id;
+
+        while ((_Id = millis_Queue_Poll()) != MILLIS_QUEUE_NONE)
+        {
+            uint32_t _Age = millis() - _Start;
+
+            BENCH_CHECK(_Id < 10);
+            if (_Id < 10)
+            {
+                BENCH_CHECK(_Age == _Due[_Id]);   /**< Exactly on its tick, the wrap does not matter */
+                BENCH_CHECK(_Age >= _Last);
+                _Last = _Age;
+            }
+            _Seen++;
+        }
+        millis_Host_RunUs(1000);
+    }
+    BENCH_CHECK(_Seen == 10);
+    BENCH_CHECK(millis_Queue_Next() == UINT32_MAX);
+};
+
+
+/* ============================================================================
+ *                         TIMEBASE CHECKS
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Start measuring micros() against the simulated cycles
+ * @param _Ppm Expected rate of micros(), 0 = the CPU clock, positive =
+ *             micros() runs fast (a trim towards a faster reference)
+ * ------------------------------------------------------- */
+static void bench_Mark(int32_t _Ppm)
+{
+    bench_Ref.Cycles = millis_Host_Cycles();
+    bench_Ref.Us     = micros();
+    bench_Ref.Ppm    = _Ppm;
+    bench_Ref.LastUs = bench_Ref.Us;
+    bench_Ref.LastMs = millis();
+};
+
+/* -------------------------------------------------------
+ * @brief Run simulated time in uneven steps and check the timebase
+ * @param _Us    Simulated time to run in microseconds
+ * @param _TolUs micros() error allowed against bench_Mark, 0 = only
+ *               check that the time is monotonic
+ * @param _TickUs Longest tick in effect, micros() runs at most this far
+ *               (plus _TolUs) ahead of millis() * 1000
+ * @note Stops at the first failed step, one report per run
+ * ------------------------------------------------------- */
+static void bench_Track(uint32_t _Us, uint32_t _TolUs, uint32_t _TickUs)
+{
+    uint64_t _End      = millis_Host_Cycles() + (((uint64_t)_Us * (F_CPU)) / 1000000ULL);
+    uint32_t _Failures = bench_Failures;
+
+    while ((millis_Host_Cycles() < _End) && (_Failures == bench_Failures))
+    {
+        uint64_t _Host;
+        int64_t  _Expect;
+        uint32_t _Now;
+        uint32_t _Ms;
+        uint32_t _Step = 1 + ((bench_Rand() * 2) % BENCH_STEP_MAX);
+
+        if (_Step > (_End - millis_Host_Cycles()))
+        {
+            _Step = (uint32_t)(_End - millis_Host_Cycles());    /**< End exactly on _Us, e.g. for the next reference edge */
+        }
+        millis_Host_Run(_Step);
+        _Now = micros();
+        _Ms  = millis();
+        BENCH_CHECK((int32_t)(_Now - bench_Ref.LastUs) >= 0);
+        BENCH_CHECK((int32_t)(_Ms - bench_Ref.LastMs) >= 0);
+        BENCH_CHECK((uint32_t)(_Now - (_Ms * 1000UL)) < (_TickUs + _TolUs));    /**< Modulo 2^32, micros() wraps with millis() * 1000 */
+        bench_Ref.LastUs = _Now;
+        bench_Ref.LastMs = _Ms;
+
+        if (_TolUs)
+        {
+            _Host   = ((millis_Host_Cycles() - bench_Ref.Cycles) * 1000000ULL) / (F_CPU);
+            _Expect = (int64_t)_Host + (((int64_t)_Host * bench_Ref.Ppm) / 1000000LL);
+            BENCH_CHECK(llabs((int64_t)(uint32_t)(_Now - bench_Ref.Us) - _Expect) <= (int64_t)_TolUs);
+        }
+    }
+};
+
+/* -------------------------------------------------------
+ * @brief millis() and micros() against the simulated cycles
+ * @note Starts a few seconds before the 2^32 wrap of micros(), so the
+ *       run also crosses it
+ * ------------------------------------------------------- */
+static void bench_Timebase(void)
+{
+    bench_Restart(4294967UL - 5000);
+    bench_Mark(0);
+    bench_Track(20000000UL, BENCH_TOL_US, 1000UL * MILLIS_MS_PER_TICK);
+};
+
+#if MILLIS_TICKLESS
+/* -------------------------------------------------------
+ * @brief Tickless sleeps in millis_Delay
+ * @note Each sleep must skip ticks, wake on time and leave millis() and
+ *       micros() caught up with the simulated cycles
+ * ------------------------------------------------------- */
+static void bench_Tickless(void)
+{
+    static const uint16_t _Sleeps[] = {1, 2, 3, 10, 16, 17, 37, 50, 200, 1000, 5};
+
+    bench_Restart(UINT32_MAX - 1000);
+    bench_Mark(0);
+    for (uint8_t _Index = 0; _Index < (sizeof(_Sleeps) / sizeof(_Sleeps[0])); _Index++)
+    {
+        uint32_t _Ticks = millis_Host_Ticks();
+        uint32_t _Start = millis();
+
+        millis_Host_Run(bench_Rand() % 16000);  /**< Sleep from a random point of the tick */
+        millis_Delay(_Sleeps[_Index]);
+        _Ticks = millis_Host_Ticks() - _Ticks;
+        BENCH_CHECK((millis() - _Start) >= _Sleeps[_Index]);
+        BENCH_CHECK((millis() - _Start) <= (_Sleeps[_Index] + 1UL));
+        if (_Sleeps[_Index] >= 10)
+        {
+            BENCH_CHECK((_Ticks * 2) <= _Sleeps[_Index]);     /**< Ticks were skipped */
+        }
+        bench_Track(2000, BENCH_TOL_US, 1000UL * MILLIS_MS_PER_TICK);
+    }
+};
+#endif
+
+#if MILLIS_TICK_RATE
+/* -------------------------------------------------------
+ * @brief Timer count of a tick rate in whole microseconds
+ * @param _Hz Tick rate
+ * @retval Count length rounded up, with the smallest Timer0 prescaler
+ *         that fits the period, as millis_SetTickRate picks it
+ * ------------------------------------------------------- */
+static uint32_t bench_CountUs(uint32_t _Hz)
+{
+    static const uint16_t _Prescalers[] = {1, 8, 64, 256, 1024};
+    uint32_t _Cycles = (F_CPU) / _Hz;
+
+    for (uint8_t _Index = 0; _Index < (sizeof(_Prescalers) / sizeof(_Prescalers[0])); _Index++)
+    {
+        if (_Cycles < ((MILLIS_COUNTER_MAX + 1UL) * _Prescalers[_Index]))
+        {
+            return ((_Prescalers[_Index] * 1000000UL) + (F_CPU) - 1) / (F_CPU);
+        }
+    }
+    return 0;
+};
+
+/* -------------------------------------------------------
+ * @brief Tick rate switches
+ * @note Every switch is made at a random point of the tick. Until the
+ *       counts carried over from the old rate are paid back (see
+ *       millis_Rate_Apply) the coarser count of the two rates is
+ *       allowed, then half a second is checked at the new rate
+ * @note micros() runs ahead of millis() * 1000 by the running tick plus
+ *       the sub-millisecond accumulator, below 1000us
+ * ------------------------------------------------------- */
+static void bench_Rate(void)
+{
+    static const uint16_t _Rates[] = {10000, 100, 1000, 10000, 1000, 100, 2000, 100, 10000};
+    uint16_t _Old = MILLIS_TICK_HZ;
+
+    bench_Restart(UINT32_MAX - 2000);
+    BENCH_CHECK(!millis_SetTickRate(3));     /**< 333.3us, not a whole number */
+    bench_Mark(0);
+    for (uint8_t _Index = 0; _Index < (sizeof(_Rates) / sizeof(_Rates[0])); _Index++)
+    {
+        uint16_t _Hz    = _Rates[_Index];
+        uint32_t _Count = (bench_CountUs(_Hz) > bench_CountUs(_Old)) ? bench_CountUs(_Hz) : bench_CountUs(_Old);
+        uint32_t _Slow  = (_Hz < _Old) ? _Hz : _Old;
+
+        bench_Track(bench_Rand() % 10000, (2 * bench_CountUs(_Old)) + 1, (1000000UL / _Old) + 1000);
+        BENCH_CHECK(millis_SetTickRate(_Hz));
+        bench_Track(BENCH_RATE_SETTLE_US, (2 * _Count) + 1, (1000000UL / _Slow) + 1000);
+        BENCH_CHECK(millis_TickRate() == _Hz);
+        bench_Track(500000UL, (2 * bench_CountUs(_Hz)) + 1, (1000000UL / _Hz) + 1000);
+        _Old = _Hz;
+    }
+};
+#endif
+
+#if MILLIS_CALIBRATE
+/* -------------------------------------------------------
+ * @brief Edge calibration against references off by a few hundred ppm
+ * @note The simulated CPU clock is exact, a reference running Ppm fast
+ *       reports BENCH_CAL_EDGE_US + Ppm * 10 us between edges 10s apart.
+ *       After a few edges micros() must follow the reference to the
+ *       resolution of two counts per edge interval
+ * ------------------------------------------------------- */
+static void bench_Calibrate(void)
+{
+    static const int16_t _Refs[] = {500, -300, 2000};
+
+    bench_Restart(0);
+    BENCH_CHECK(millis_Calibrate_Edge(1000000UL) == MILLIS_CAL_NO_EDGE);
+    bench_Mark(0);
+    for (uint8_t _Index = 0; _Index < (sizeof(_Refs) / sizeof(_Refs[0])); _Index++)
+    {
+        uint32_t _RefUs = (uint32_t)(BENCH_CAL_EDGE_US + ((int32_t)_Refs[_Index] * (int32_t)(BENCH_CAL_EDGE_US / 1000000UL)));
+        int32_t  _Ppm   = 0;
+
+        millis_Calibrate_Restart();
+        for (uint8_t _Edge = 0; _Edge < 5; _Edge++)
+        {
+            bench_Track(BENCH_CAL_EDGE_US, 0, 1000);  /**< Monotonic across every trim */
+            millis_Calibrate_Stamp();
+            _Ppm = millis_Calibrate_Edge(_RefUs);
+            if (_Edge == 0)
+            {
+                BENCH_CHECK(_Ppm == 0);          /**< First edge only starts the measurement */
+            }
+        }
+        BENCH_CHECK((_Ppm >= -BENCH_CAL_PPM) && (_Ppm <= BENCH_CAL_PPM));   /**< Settled on the reference */
+
+        bench_Mark(_Refs[_Index]);
+        bench_Track(5000000UL, BENCH_TOL_US + (5 * BENCH_CAL_PPM), 1000);  /**< Residual trim over 5s on top */
+    }
+    millis_Calibrate_Set(MILLIS_CAL_NOMINAL);
+};
+#endif
+
+
+/* ============================================================================
+ *                         SCHEDULER BENCHMARK
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Time scheduler passes
+ * @param _Count Tasks in the table
+ * @note The idle pass runs with no task due. The busy pass advances 1ms
+ *       before every pass with all tasks at 1ms, the cost of the
+ *       simulated tick is measured alone and taken off
+ * ------------------------------------------------------- */
+static void bench_Scheduler(uint8_t _Count)
+{
+    millis_Task_T _Tasks[32];
+    uint64_t _Ns;
+    uint64_t _Idle;
+    uint64_t _Busy;
+    uint64_t _Tick;
+
+    bench_Restart(0);
+    for (uint8_t _Index = 0; _Index < _Count; _Index++)
+    {
+        _Tasks[_Index].Callback       = bench_Task;
+        _Tasks[_Index].Timer.Previous = 0;
+        _Tasks[_Index].Timer.Delta    = 0;
+        _Tasks[_Index].Timer.Interval = 1000000UL;     /**< Not due during the idle run */
+        _Tasks[_Index].Mode           = MILLIS_FIXED_DELAY;
+    }
+
+    _Ns = bench_Ns();
+    for (uint32_t _Pass = 0; _Pass < BENCH_SCHED_PASSES; _Pass++)
+    {
+        (void)millis_Scheduler(_Tasks, _Count);
+    }
+    _Idle = bench_Ns() - _Ns;
+
+    for (uint8_t _Index = 0; _Index < _Count; _Index++)
+    {
+        _Tasks[_Index].Timer.Previous = millis();
+        _Tasks[_Index].Timer.Interval = 1;
+        _Tasks[_Index].Mode           = MILLIS_FIXED_RATE;
+    }
+    bench_Calls = 0;
+    _Ns = bench_Ns();
+    for (uint32_t _Pass = 0; _Pass < BENCH_SCHED_PASSES; _Pass++)
+    {
+        millis_Host_RunUs(1000);
+        (void)millis_Scheduler(_Tasks, _Count);
+    }
+    _Busy = bench_Ns() - _Ns;
+    BENCH_CHECK(bench_Calls == (BENCH_SCHED_PASSES * _Count));
+
+    _Ns = bench_Ns();
+    for (uint32_t _Pass = 0; _Pass < BENCH_SCHED_PASSES; _Pass++)
+    {
+        millis_Host_RunUs(1000);
+    }
+    _Tick = bench_Ns() - _Ns;
+    _Busy = (_Busy > _Tick) ? (_Busy - _Tick) : 0;
+
+    printf("scheduler %3u tasks : idle pass %7.1f ns, all due %7.1f ns (%5.1f ns per task)\n",
+           _Count,
+           (double)_Idle / BENCH_SCHED_PASSES,
+           (double)_Busy / BENCH_SCHED_PASSES,
+           (double)_Busy / (BENCH_SCHED_PASSES * _Count));
+};
+
+
+/* ============================================================================
+ *                         QUEUE BENCHMARK
+ * ============================================================================ */
+
+/* -------------------------------------------------------
+ * @brief Time queue insert, expire and cancel
+ * @param _Count Timers armed per round, 1..255
+ * @note Every round fills the queue with random timeouts, jumps the
+ *       simulated clock past all of them and drains it. A second fill
+ *       is cancelled in reverse order. Each drain is checked for count
+ *       and order
+ * ------------------------------------------------------- */
+static void bench_Queue(uint16_t _Count)
+{
+    static uint32_t _Deadline[255];
+    uint64_t _Insert = 0;
+    uint64_t _Expire = 0;
+    uint64_t _Cancel = 0;
+    uint64_t _Ns;
+
+    bench_Restart(UINT32_MAX - (BENCH_QUEUE_SPREAD * (BENCH_QUEUE_ROUNDS / 2)));   /**< Half the rounds run past the wrap */
+    for (uint32_t _Round = 0; _Round < BENCH_QUEUE_ROUNDS; _Round++)
+    {
+        uint32_t _Now = millis();
+        uint32_t _Last = 0;
+        uint16_t _Seen = 0;
+        uint8_t  _Id;
+
+        millis_Queue_Init();
+        for (uint16_t _Index = 0; _Index < _Count; _Index++)
+        {
+            _Deadline[_Index] = 1 + (bench_Rand() % BENCH_QUEUE_SPREAD);
+        }
+        _Ns = bench_Ns();
+        for (uint16_t _Index = 0; _Index < _Count; _Index++)
+        {
+            (void)millis_Queue_Start((uint8_t)_Index, _Deadline[_Index]);
+        }
+        _Insert += bench_Ns() - _Ns;
+
+        System_millis = _Now + BENCH_QUEUE_SPREAD;    /**< Everything due, no need to simulate the ticks */
+        _Ns = bench_Ns();
+        while ((_Id = millis_Queue_Poll()) != MILLIS_QUEUE_NONE)
+        {
+            _Deadline[_Id] |= 0x80000000UL;         /**< Mark as seen, the timeout stays in the low bits */
+            _Seen++;
+        }
+        _Expire += bench_Ns() - _Ns;
+
+        BENCH_CHECK(_Seen == _Count);
+        for (uint16_t _Index = 0; _Index < _Count; _Index++)
+        {
+            BENCH_CHECK(_Deadline[_Index] & 0x80000000UL);
+            _Deadline[_Index] &= 0x7FFFFFFFUL;
+        }
+
+        /* Order check on a second drain, one poll per simulated jump */
+        millis_Queue_Init();
+        for (uint16_t _Index = 0; _Index < _Count; _Index++)
+        {
+            (void)millis_Queue_Start((uint8_t)_Index, _Deadline[_Index]);
+        }
+        _Now = millis();
+        System_millis = _Now + BENCH_QUEUE_SPREAD;
+        while ((_Id = millis_Queue_Poll()) != MILLIS_QUEUE_NONE)
+        {
+            BENCH_CHECK(_Deadline[_Id] >= _Last);    /**< Earliest first */
+            _Last = _Deadline[_Id];
+        }
+
+        millis_Queue_Init();
+        for (uint16_t _Index = 0; _Index < _Count; _Index++)
+        {
+            (void)millis_Queue_Start((uint8_t)_Index, _Deadline[_Index]);
+        }
+        _Ns = bench_Ns();
+        for (uint16_t _Index = _Count; _Index > 0; _Index--)
+        {
+            millis_Queue_Cancel((uint8_t)(_Index - 1));
+        }
+        _Cancel += bench_Ns() - _Ns;
+        BENCH_CHECK(millis_Queue_Next() == UINT32_MAX);
+
+        System_millis += 1;                  /**< Next round starts a little later, crossing the wrap halfway */
+    }
+
+    printf("queue     %3u timers: start %6.1f ns, expire %6.1f ns, cancel %6.1f ns per timer\n",
+           _Count,
+           (double)_Insert / (BENCH_QUEUE_ROUNDS * _Count),
+           (double)_Expire / (BENCH_QUEUE_ROUNDS * _Count),
+           (double)_Cancel / (BENCH_QUEUE_ROUNDS * _Count));
+};
+
+
+/* ============================================================================
+ *                         MAIN
+ * ============================================================================ */
+int main(void)
+{
+    static const uint8_t  _Tasks[]  = {1, 8, 32};
+    static const uint16_t _Timers[] = {10, 50, 100, 200, 255};
+
+    bench_Timebase();
+#if MILLIS_TICKLESS
+    bench_Tickless();
+#endif
+#if MILLIS_TICK_RATE
+    bench_Rate();
+#endif
+#if MILLIS_CALIBRATE
+    bench_Calibrate();
+#endif
+    bench_WrapCounter();
+    bench_WrapTimer();
+    bench_WrapCompact();
+    bench_WrapQueue();
+
+    for (uint8_t _Index = 0; _Index < sizeof(_Tasks); _Index++)
+    {
+        bench_Scheduler(_Tasks[_Index]);
+    }
+    for (uint8_t _Index = 0; _Index < (sizeof(_Timers) / sizeof(_Timers[0])); _Index++)
+    {
+        bench_Queue(_Timers[_Index]);
+    }
+    printf("queue capacity is 255 timers (MILLIS_QUEUE_SIZE), larger counts are not possible\n");
+
+    if (bench_Failures)
+    {
+        printf("%lu check(s) FAILED\n", (unsigned long)bench_Failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+};